@@ -0,0 +1,302 @@
+#include <stdbool.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "attacks.h"
+#include "cpu.h"
+
+#define ROOK_TABLE_SIZE 102400
+#define BISHOP_TABLE_SIZE 5248
+
+#define NOT_FILE_A_BB 0xFEFEFEFEFEFEFEFEULL
+#define NOT_FILE_AB_BB 0xFCFCFCFCFCFCFCFCULL
+#define NOT_FILE_H_BB 0x7F7F7F7F7F7F7F7FULL
+#define NOT_FILE_GH_BB 0x3F3F3F3F3F3F3F3FULL
+
+// leaper attacks of a square as constant expressions, the file masks drop the steps that wrap around an edge
+#define KNIGHT_ATTACKS(s)                                                                                    \
+    (((SQUARE_BB(s) << 17) & NOT_FILE_A_BB) | ((SQUARE_BB(s) << 15) & NOT_FILE_H_BB) |                      \
+     ((SQUARE_BB(s) << 10) & NOT_FILE_AB_BB) | ((SQUARE_BB(s) << 6) & NOT_FILE_GH_BB) |                     \
+     ((SQUARE_BB(s) >> 17) & NOT_FILE_H_BB) | ((SQUARE_BB(s) >> 15) & NOT_FILE_A_BB) |                      \
+     ((SQUARE_BB(s) >> 10) & NOT_FILE_GH_BB) | ((SQUARE_BB(s) >> 6) & NOT_FILE_AB_BB))
+#define KING_ATTACKS(s)                                                                                      \
+    ((SQUARE_BB(s) << 8) | (SQUARE_BB(s) >> 8) | ((SQUARE_BB(s) << 1) & NOT_FILE_A_BB) |                    \
+     ((SQUARE_BB(s) >> 1) & NOT_FILE_H_BB) | ((SQUARE_BB(s) << 9) & NOT_FILE_A_BB) |                        \
+     ((SQUARE_BB(s) << 7) & NOT_FILE_H_BB) | ((SQUARE_BB(s) >> 7) & NOT_FILE_A_BB) |                        \
+     ((SQUARE_BB(s) >> 9) & NOT_FILE_H_BB))
+#define WHITE_PAWN_ATTACKS(s) (((SQUARE_BB(s) << 9) & NOT_FILE_A_BB) | ((SQUARE_BB(s) << 7) & NOT_FILE_H_BB))
+#define BLACK_PAWN_ATTACKS(s) (((SQUARE_BB(s) >> 7) & NOT_FILE_A_BB) | ((SQUARE_BB(s) >> 9) & NOT_FILE_H_BB))
+
+// expands f over all 64 squares into an initializer list
+#define RANK_ENTRIES(f, s) f(s), f(s + 1), f(s + 2), f(s + 3), f(s + 4), f(s + 5), f(s + 6), f(s + 7)
+#define SQUARE_TABLE(f)                                                                                      \
+    {                                                                                                        \
+        RANK_ENTRIES(f, 0), RANK_ENTRIES(f, 8), RANK_ENTRIES(f, 16), RANK_ENTRIES(f, 24),                    \
+            RANK_ENTRIES(f, 32), RANK_ENTRIES(f, 40), RANK_ENTRIES(f, 48), RANK_ENTRIES(f, 56)               \
+    }
+
+const Bitboard knight_attacks[64] = SQUARE_TABLE(KNIGHT_ATTACKS);
+const Bitboard king_attacks[64] = SQUARE_TABLE(KING_ATTACKS);
+const Bitboard pawn_attacks[2][64] = {SQUARE_TABLE(BLACK_PAWN_ATTACKS), SQUARE_TABLE(WHITE_PAWN_ATTACKS)};
+
+Magic bishop_magics[64];
+Magic rook_magics[64];
+SliderIndexing slider_indexing = SLIDER_INDEX_MAGIC;
+
+Bitboard between_bb[64][64];
+Bitboard line_bb[64][64];
+
+static Bitboard rook_table[ROOK_TABLE_SIZE];
+static Bitboard bishop_table[BISHOP_TABLE_SIZE];
+
+static const int bishop_directions[4][2] = {{1, 1}, {1, -1}, {-1, -1}, {-1, 1}};
+static const int rook_directions[4][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}};
+
+static Bitboard slide(int square, Bitboard occupancy, const int directions[4][2]);
+static void init_magics(Magic magics[64], Bitboard *table, Bitboard (*slow_attacks)(int, Bitboard));
+static Bitboard random_sparse(uint64_t *state);
+static void init_lines(Bitboard (*slow_attacks)(int, Bitboard));
+static Bitboard sliders_lookup(Bitboard diagonal, Bitboard orthogonal, Bitboard occupancy);
+
+Bitboard (*attacks_sliders)(Bitboard diagonal, Bitboard orthogonal, Bitboard occupancy) = sliders_lookup;
+
+#if defined(__x86_64__)
+static Bitboard sliders_avx2(Bitboard diagonal, Bitboard orthogonal, Bitboard occupancy);
+#endif
+
+void attacks_init(void)
+{
+    attacks_init_with_features(cpu_features());
+}
+
+void attacks_init_with_features(unsigned features)
+{
+    slider_indexing = SLIDER_INDEX_MAGIC;
+    attacks_sliders = sliders_lookup;
+
+#if defined(__x86_64__)
+    if (features & CPU_BMI2)
+    {
+        slider_indexing = SLIDER_INDEX_PEXT;
+    }
+    if (features & CPU_AVX2)
+    {
+        attacks_sliders = sliders_avx2;
+    }
+#endif
+
+    init_magics(bishop_magics, bishop_table, attacks_bishop_slow);
+    init_magics(rook_magics, rook_table, attacks_rook_slow);
+    init_lines(attacks_bishop_slow);
+    init_lines(attacks_rook_slow);
+}
+
+const char *attacks_backend_name(void)
+{
+    if (slider_indexing == SLIDER_INDEX_PEXT)
+    {
+        return attacks_sliders == sliders_lookup ? "pext" : "pext, avx2";
+    }
+    return attacks_sliders == sliders_lookup ? "magic" : "magic, avx2";
+}
+
+Bitboard attacks_bishop_slow(int square, Bitboard occupancy)
+{
+    return slide(square, occupancy, bishop_directions);
+}
+
+Bitboard attacks_rook_slow(int square, Bitboard occupancy)
+{
+    return slide(square, occupancy, rook_directions);
+}
+
+static Bitboard slide(int square, Bitboard occupancy, const int directions[4][2])
+{
+    Bitboard attacks = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        int x = SQUARE_FILE(square) + directions[i][0];
+        int y = SQUARE_RANK(square) + directions[i][1];
+
+        while (x >= 0 && x < 8 && y >= 0 && y < 8)
+        {
+            Bitboard bb = SQUARE_BB(SQUARE_INDEX(x, y));
+            attacks |= bb;
+
+            if (occupancy & bb)
+            {
+                break;
+            }
+
+            x += directions[i][0];
+            y += directions[i][1];
+        }
+    }
+
+    return attacks;
+}
+
+// finds a magic for every square by trial and error with a fixed seed, so the tables are the same on every
+// run. with pext indexing the table of a square is simply laid out in pext order instead
+static void init_magics(Magic magics[64], Bitboard *table, Bitboard (*slow_attacks)(int, Bitboard))
+{
+    Bitboard occupancies[4096], references[4096];
+    int epoch[4096] = {0};
+    int attempt = 0;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    Bitboard *next_table = table;
+
+    for (int square = 0; square < 64; square++)
+    {
+        Magic *m = &magics[square];
+
+        Bitboard rank_bb = RANK_1_BB << (8 * SQUARE_RANK(square));
+        Bitboard file_bb = FILE_A_BB << SQUARE_FILE(square);
+        Bitboard edges = ((RANK_1_BB | RANK_8_BB) & ~rank_bb) | ((FILE_A_BB | FILE_H_BB) & ~file_bb);
+
+        m->mask = slow_attacks(square, 0) & ~edges;
+        m->shift = 64 - bb_popcount(m->mask);
+        m->attacks = next_table;
+
+        // enumerate every subset of the mask (carry-rippler) with its attack set
+        int size = 0;
+        Bitboard occupancy = 0;
+        do
+        {
+            occupancies[size] = occupancy;
+            references[size] = slow_attacks(square, occupancy);
+            size++;
+            occupancy = (occupancy - m->mask) & m->mask;
+        } while (occupancy);
+
+        next_table += size;
+
+#if defined(__x86_64__)
+        if (slider_indexing == SLIDER_INDEX_PEXT)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                m->attacks[bb_pext(occupancies[i], m->mask)] = references[i];
+            }
+            continue;
+        }
+#endif
+
+        for (int i = 0; i < size;)
+        {
+            do
+            {
+                m->magic = random_sparse(&seed);
+            } while (bb_popcount((m->mask * m->magic) >> 56) < 6);
+
+            // epoch marks which table slots were written by the current attempt, so nothing needs clearing
+            attempt++;
+            for (i = 0; i < size; i++)
+            {
+                unsigned index = ((occupancies[i] & m->mask) * m->magic) >> m->shift;
+
+                if (epoch[index] < attempt)
+                {
+                    epoch[index] = attempt;
+                    m->attacks[index] = references[i];
+                }
+                else if (m->attacks[index] != references[i])
+                {
+                    break; // destructive collision, try another magic
+                }
+            }
+        }
+    }
+}
+
+// fills between_bb and line_bb for the pairs of squares sharing a diagonal or a rank and file
+static void init_lines(Bitboard (*slow_attacks)(int, Bitboard))
+{
+    for (int a = 0; a < 64; a++)
+    {
+        for (int b = 0; b < 64; b++)
+        {
+            if (a != b && (slow_attacks(a, 0) & SQUARE_BB(b)))
+            {
+                between_bb[a][b] = slow_attacks(a, SQUARE_BB(b)) & slow_attacks(b, SQUARE_BB(a));
+                line_bb[a][b] = (slow_attacks(a, 0) & slow_attacks(b, 0)) | SQUARE_BB(a) | SQUARE_BB(b);
+            }
+        }
+    }
+}
+
+static Bitboard sliders_lookup(Bitboard diagonal, Bitboard orthogonal, Bitboard occupancy)
+{
+    Bitboard attacks = 0;
+
+    while (diagonal)
+    {
+        attacks |= attacks_bishop(bb_pop_lsb(&diagonal), occupancy);
+    }
+    while (orthogonal)
+    {
+        attacks |= attacks_rook(bb_pop_lsb(&orthogonal), occupancy);
+    }
+
+    return attacks;
+}
+
+#if defined(__x86_64__)
+// occluded Kogge-Stone fill of the four up and the four down directions, one direction per 64 bit lane. the
+// lanes shift by 8 (north/south), 1 (east/west), 9 and 7 (the diagonals), the masks drop wrapped files
+__attribute__((target("avx2"))) static Bitboard sliders_avx2(Bitboard diagonal, Bitboard orthogonal,
+                                                             Bitboard occupancy)
+{
+    const __m256i shift = _mm256_set_epi64x(7, 9, 1, 8);
+    const __m256i up_mask = _mm256_set_epi64x(NOT_FILE_H_BB, NOT_FILE_A_BB, NOT_FILE_A_BB, ~0ULL);
+    const __m256i down_mask = _mm256_set_epi64x(NOT_FILE_A_BB, NOT_FILE_H_BB, NOT_FILE_H_BB, ~0ULL);
+    __m256i empty = _mm256_set1_epi64x(~occupancy);
+    __m256i sliders = _mm256_set_epi64x(diagonal, diagonal, orthogonal, orthogonal);
+
+    __m256i up = sliders;
+    __m256i propagate = _mm256_and_si256(empty, up_mask);
+    __m256i step = shift;
+    for (int i = 0; i < 3; i++)
+    {
+        up = _mm256_or_si256(up, _mm256_and_si256(propagate, _mm256_sllv_epi64(up, step)));
+        propagate = _mm256_and_si256(propagate, _mm256_sllv_epi64(propagate, step));
+        step = _mm256_add_epi64(step, step);
+    }
+    up = _mm256_and_si256(_mm256_sllv_epi64(up, shift), up_mask);
+
+    __m256i down = sliders;
+    propagate = _mm256_and_si256(empty, down_mask);
+    step = shift;
+    for (int i = 0; i < 3; i++)
+    {
+        down = _mm256_or_si256(down, _mm256_and_si256(propagate, _mm256_srlv_epi64(down, step)));
+        propagate = _mm256_and_si256(propagate, _mm256_srlv_epi64(propagate, step));
+        step = _mm256_add_epi64(step, step);
+    }
+    down = _mm256_and_si256(_mm256_srlv_epi64(down, shift), down_mask);
+
+    __m256i lanes = _mm256_or_si256(up, down);
+    __m128i halves = _mm_or_si128(_mm256_castsi256_si128(lanes), _mm256_extracti128_si256(lanes, 1));
+    return _mm_cvtsi128_si64(halves) | _mm_extract_epi64(halves, 1);
+}
+#endif
+
+// xorshift64*, and-ing three numbers gives the few set bits good magics tend to have
+static Bitboard random_sparse(uint64_t *state)
+{
+    Bitboard result = ~0ULL;
+
+    for (int i = 0; i < 3; i++)
+    {
+        *state ^= *state >> 12;
+        *state ^= *state << 25;
+        *state ^= *state >> 27;
+        result &= *state * 0x2545F4914F6CDD1DULL;
+    }
+
+    return result;
+}
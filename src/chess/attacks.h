@@ -0,0 +1,93 @@
+#if !defined(ATTACKS_H)
+#define ATTACKS_H
+
+#include "bitboard.h"
+#include "piece.h"
+
+// fancy magic bitboard entry for one square of a sliding piece
+typedef struct
+{
+    Bitboard *attacks; // attack sets indexed by the magic hash, or the pext, of the occupancy
+    Bitboard mask;     // relevant occupancy, excluding the edge squares
+    Bitboard magic;
+    int shift;
+} Magic;
+
+// how the slider tables are indexed, both layouts use the same table slots
+typedef enum
+{
+    SLIDER_INDEX_MAGIC,
+    SLIDER_INDEX_PEXT,
+} SliderIndexing;
+
+extern Magic bishop_magics[64];
+extern Magic rook_magics[64];
+extern SliderIndexing slider_indexing;
+
+// attacks of all the diagonal and all the orthogonal sliders on a board at once, dispatched to an AVX2
+// Kogge-Stone fill or to one table lookup per piece
+extern Bitboard (*attacks_sliders)(Bitboard diagonal, Bitboard orthogonal, Bitboard occupancy);
+
+// leaper attacks, fixed at compile time so they need no initialization
+extern const Bitboard knight_attacks[64];
+extern const Bitboard king_attacks[64];
+extern const Bitboard pawn_attacks[2][64]; // indexed by the color of the pawn, then its square
+
+extern Bitboard between_bb[64][64]; // squares strictly between two squares on a shared line, 0 if not aligned
+extern Bitboard line_bb[64][64];    // whole board line through two squares, 0 if not aligned
+
+// builds the sliding attack and line tables, must be called once at startup before any move generation. the
+// kernels are picked from the CpuFeature bits of the cpu we run on
+void attacks_init(void);
+
+// same with the given CpuFeature bits, so the fallbacks can be run on a machine that has the extensions
+void attacks_init_with_features(unsigned features);
+
+// describes the kernels picked by attacks_init, for reports
+const char *attacks_backend_name(void);
+
+// reference ray walkers, used to fill the tables and as a baseline for benchmarks
+Bitboard attacks_bishop_slow(int square, Bitboard occupancy);
+Bitboard attacks_rook_slow(int square, Bitboard occupancy);
+
+static inline Bitboard attacks_knight(int square) { return knight_attacks[square]; }
+
+static inline Bitboard attacks_king(int square) { return king_attacks[square]; }
+
+// squares a pawn of the given color on square captures on
+static inline Bitboard attacks_pawn(int square, ChessColor color) { return pawn_attacks[color][square]; }
+
+// the branch on slider_indexing never changes after startup, so it is always predicted
+static inline unsigned slider_index(const Magic *m, Bitboard occupancy)
+{
+#if defined(__x86_64__)
+    if (slider_indexing == SLIDER_INDEX_PEXT)
+    {
+        return bb_pext(occupancy, m->mask);
+    }
+#endif
+    return ((occupancy & m->mask) * m->magic) >> m->shift;
+}
+
+static inline Bitboard attacks_bishop(int square, Bitboard occupancy)
+{
+    const Magic *m = &bishop_magics[square];
+    return m->attacks[slider_index(m, occupancy)];
+}
+
+static inline Bitboard attacks_rook(int square, Bitboard occupancy)
+{
+    const Magic *m = &rook_magics[square];
+    return m->attacks[slider_index(m, occupancy)];
+}
+
+static inline Bitboard attacks_queen(int square, Bitboard occupancy)
+{
+    return attacks_bishop(square, occupancy) | attacks_rook(square, occupancy);
+}
+
+static inline Bitboard attacks_between(int a, int b) { return between_bb[a][b]; }
+
+static inline Bitboard attacks_line(int a, int b) { return line_bb[a][b]; }
+
+#endif
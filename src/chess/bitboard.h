@@ -0,0 +1,49 @@
+#if !defined(BITBOARD_H)
+#define BITBOARD_H
+
+#include <stdint.h>
+
+#include "../types.h"
+
+// one bit per square, bit index = y * 8 + x (a1 = 0, h1 = 7, a8 = 56, h8 = 63)
+typedef uint64_t Bitboard;
+
+#define SQUARE_INDEX(x, y) ((y) * 8 + (x))
+#define SQUARE_FILE(square) ((square) & 7)
+#define SQUARE_RANK(square) ((square) >> 3)
+#define SQUARE_BB(square) ((Bitboard)1 << (square))
+
+#define FILE_A_BB 0x0101010101010101ULL
+#define FILE_H_BB 0x8080808080808080ULL
+#define RANK_1_BB 0x00000000000000FFULL
+#define RANK_8_BB 0xFF00000000000000ULL
+
+static inline int square_from_vec(Vec2i square) { return SQUARE_INDEX(square.x, square.y); }
+
+static inline Vec2i square_to_vec(int square) { return (Vec2i){SQUARE_FILE(square), SQUARE_RANK(square)}; }
+
+static inline int bb_popcount(Bitboard bb) { return __builtin_popcountll(bb); }
+
+// index of the least significant set bit, bb must not be empty
+static inline int bb_lsb(Bitboard bb) { return __builtin_ctzll(bb); }
+
+// removes the least significant set bit from bb and returns its index, bb must not be empty
+static inline int bb_pop_lsb(Bitboard *bb)
+{
+    int square = __builtin_ctzll(*bb);
+    *bb &= *bb - 1;
+    return square;
+}
+
+// parallel bit extract, gathers the bits of bb selected by mask into the low bits. only defined on x86-64 and
+// only valid to call when the cpu has BMI2, inline assembly keeps the rest of the build free of -mbmi2
+#if defined(__x86_64__)
+static inline uint64_t bb_pext(Bitboard bb, Bitboard mask)
+{
+    uint64_t result;
+    __asm__("pextq %2, %1, %0" : "=r"(result) : "r"(bb), "rm"(mask));
+    return result;
+}
+#endif
+
+#endif
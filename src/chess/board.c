@@ -1,270 +1,290 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <ctype.h>
 
 #include "../types.h"
+#include "attacks.h"
 #include "board.h"
 #include "movegen.h"
-
-static void update_castling_rights(ChessBoard *self, ChessColor color, CastlingRightsRemoved removed_rights,
-                                   bool restore_rights);
-static void parse_castling_rights(ChessBoard *self, const char *fen_castling);
-static void parse_turn(ChessBoard *self, const char *fen_turn);
+#include "zobrist.h"
+
+// the rights that survive a move from or to each square, moving the king or a rook or capturing a rook on
+// its starting square clears the matching bits
+static const CastlingRights castling_rights_mask[64] = {
+    CASTLE_ALL & ~CASTLE_WHITE_QUEEN_SIDE, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+    CASTLE_ALL & ~(CASTLE_WHITE_KING_SIDE | CASTLE_WHITE_QUEEN_SIDE), CASTLE_ALL, CASTLE_ALL,
+    CASTLE_ALL & ~CASTLE_WHITE_KING_SIDE,
+    CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+    CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+    CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+    CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+    CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+    CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+    CASTLE_ALL & ~CASTLE_BLACK_QUEEN_SIDE, CASTLE_ALL, CASTLE_ALL, CASTLE_ALL,
+    CASTLE_ALL & ~(CASTLE_BLACK_KING_SIDE | CASTLE_BLACK_QUEEN_SIDE), CASTLE_ALL, CASTLE_ALL,
+    CASTLE_ALL & ~CASTLE_BLACK_KING_SIDE,
+};
+
+static void clear_board(ChessBoard *self);
+static bool can_capture_en_passant(const ChessBoard *self, int square, ChessColor capturer);
+static bool is_material_reachable(const ChessBoard *self, ChessColor color);
+static void put_piece(ChessBoard *self, int square, PieceType type, ChessColor color);
+static void remove_piece(ChessBoard *self, int square);
+static void move_piece(ChessBoard *self, int from, int to);
+static void set_piece_type(ChessBoard *self, int square, PieceType type);
+static void set_king_pos(ChessBoard *self, ChessColor color, int square);
+static uint64_t material_delta(uint8_t code, int square);
 
 void chess_board_init(ChessBoard *self)
 {
+    clear_board(self);
+
     // pawns
     for (int i = 0; i < 8; i++)
     {
-        self->squares[i][1] = chess_piece_new(PIECE_PAWN, WHITE);
-        self->squares[i][6] = chess_piece_new(PIECE_PAWN, BLACK);
+        put_piece(self, SQUARE_INDEX(i, 1), PIECE_PAWN, WHITE);
+        put_piece(self, SQUARE_INDEX(i, 6), PIECE_PAWN, BLACK);
     }
     // other pieces
-    self->squares[0][0] = chess_piece_new(PIECE_ROOK, WHITE);
-    self->squares[1][0] = chess_piece_new(PIECE_KNIGHT, WHITE);
-    self->squares[2][0] = chess_piece_new(PIECE_BISHOP, WHITE);
-    self->squares[3][0] = chess_piece_new(PIECE_QUEEN, WHITE);
-    self->squares[4][0] = chess_piece_new(PIECE_KING, WHITE);
-    self->squares[5][0] = chess_piece_new(PIECE_BISHOP, WHITE);
-    self->squares[6][0] = chess_piece_new(PIECE_KNIGHT, WHITE);
-    self->squares[7][0] = chess_piece_new(PIECE_ROOK, WHITE);
-
-    self->squares[0][7] = chess_piece_new(PIECE_ROOK, BLACK);
-    self->squares[1][7] = chess_piece_new(PIECE_KNIGHT, BLACK);
-    self->squares[2][7] = chess_piece_new(PIECE_BISHOP, BLACK);
-    self->squares[3][7] = chess_piece_new(PIECE_QUEEN, BLACK);
-    self->squares[4][7] = chess_piece_new(PIECE_KING, BLACK);
-    self->squares[5][7] = chess_piece_new(PIECE_BISHOP, BLACK);
-    self->squares[6][7] = chess_piece_new(PIECE_KNIGHT, BLACK);
-    self->squares[7][7] = chess_piece_new(PIECE_ROOK, BLACK);
-
-    self->white_king_pos = (Vec2i){4, 0};
-    self->black_king_pos = (Vec2i){4, 7};
-
-    // empty squares
+    PieceType back_rank[8] = {PIECE_ROOK, PIECE_KNIGHT, PIECE_BISHOP, PIECE_QUEEN,
+                              PIECE_KING, PIECE_BISHOP, PIECE_KNIGHT, PIECE_ROOK};
     for (int i = 0; i < 8; i++)
     {
-        for (int j = 2; j < 6; j++)
-        {
-            self->squares[i][j] = NULL;
-        }
+        put_piece(self, SQUARE_INDEX(i, 0), back_rank[i], WHITE);
+        put_piece(self, SQUARE_INDEX(i, 7), back_rank[i], BLACK);
     }
 
-    self->last_move = NULL;
-    self->castling_rights = (CastlingRights){1, 1, 1, 1};
+    self->white_king_pos = (Vec2i){4, 0};
+    self->black_king_pos = (Vec2i){4, 7};
+
+    self->castling_rights = CASTLE_ALL;
+    self->turn = WHITE;
+    self->hash = zobrist_hash(self);
 }
 
-void chess_board_make_move(ChessBoard *self, ChessPiece *piece, ChessMove *move)
+void chess_board_make_move(ChessBoard *self, ChessMove move, MoveUndo *undo)
 {
-    Vec2i from = move->from;
-    Vec2i to = move->to;
-
-    ChessPiece *piece_on_target_square = self->squares[to.x][to.y];
-
-    // capture
-    if (piece_on_target_square != NULL)
+    int from = move_from(move);
+    int to = move_to(move);
+    int flags = move_flags(move);
+    int rank = SQUARE_RANK(from);
+    ChessColor color = PIECE_CODE_COLOR(self->mailbox[from]);
+
+    undo->move = move;
+    undo->captured = PIECE_CODE_NONE;
+    undo->en_passant_square = self->en_passant_square;
+    undo->castling_rights = self->castling_rights;
+    undo->halfmove_clock = self->halfmove_clock;
+    undo->hash = self->hash;
+
+    bool is_irreversible = move_is_capture(move) || PIECE_CODE_TYPE(self->mailbox[from]) == PIECE_PAWN;
+    self->halfmove_clock = is_irreversible ? 0 : self->halfmove_clock + 1;
+
+    // the piece keys are updated by the helpers below, the rest is taken out here and put back at the end
+    self->hash ^= zobrist_castling_key(self->castling_rights);
+    if (self->en_passant_square != NO_SQUARE)
     {
-        chess_piece_delete(piece_on_target_square);
+        self->hash ^= zobrist_en_passant[SQUARE_FILE(self->en_passant_square)];
     }
 
-    switch (move->type)
+    switch (flags)
     {
-    case EN_PASSANT:
-        chess_piece_delete(self->squares[to.x][from.y]);
-        self->squares[to.x][from.y] = NULL;
+    case MOVE_EN_PASSANT:
+    {
+        int captured_square = SQUARE_INDEX(SQUARE_FILE(to), rank);
+        undo->captured = self->mailbox[captured_square];
+        remove_piece(self, captured_square);
         break;
-    case CASTLE_KINGSIDE:
-        if (piece->color == WHITE)
-        {
-            self->squares[5][0] = self->squares[7][0];
-            self->squares[7][0] = NULL;
-        }
-        else
-        {
-            self->squares[5][7] = self->squares[7][7];
-            self->squares[7][7] = NULL;
-        }
+    }
+    case MOVE_CASTLE_KINGSIDE:
+        move_piece(self, SQUARE_INDEX(7, rank), SQUARE_INDEX(5, rank));
         break;
-    case CASTLE_QUEENSIDE:
-        if (piece->color == WHITE)
-        {
-            self->squares[3][0] = self->squares[0][0];
-            self->squares[0][0] = NULL;
-        }
-        else
+    case MOVE_CASTLE_QUEENSIDE:
+        move_piece(self, SQUARE_INDEX(0, rank), SQUARE_INDEX(3, rank));
+        break;
+    default:
+        if (move_is_capture(move))
         {
-            self->squares[3][7] = self->squares[0][7];
-            self->squares[0][7] = NULL;
+            undo->captured = self->mailbox[to];
+            remove_piece(self, to);
         }
         break;
     }
 
-    self->squares[to.x][to.y] = piece;
-    self->squares[from.x][from.y] = NULL;
+    move_piece(self, from, to);
 
-    if (piece->type == PIECE_KING)
+    if (move_is_promotion(move))
     {
-        if (piece->color == WHITE)
-        {
-            self->white_king_pos = to;
-        }
-        else
-        {
-            self->black_king_pos = to;
-        }
+        set_piece_type(self, to, move_promotion_type(move));
     }
-
-    CastlingRightsRemoved removed_rights = move->castling_rights_removed;
-    if (removed_rights != CASTLING_RIGHT_NONE)
+    else if (PIECE_CODE_TYPE(self->mailbox[to]) == PIECE_KING)
     {
-        update_castling_rights(self, piece->color, removed_rights, false);
+        set_king_pos(self, color, to);
     }
 
-    // account for castling rights removed when a rook is captured
-    CastlingRightsRemoved opp_castling_rights_removed = move->opponent_castling_rights_removed;
-    if (opp_castling_rights_removed != CASTLING_RIGHT_NONE)
-    {
-        update_castling_rights(self, !piece->color, opp_castling_rights_removed, false);
-    }
+    self->castling_rights &= castling_rights_mask[from] & castling_rights_mask[to];
+    self->hash ^= zobrist_castling_key(self->castling_rights);
 
-    if (self->last_move != NULL)
+    self->en_passant_square = NO_SQUARE;
+    if (flags == MOVE_DOUBLE_PUSH && can_capture_en_passant(self, (from + to) / 2, !color))
     {
-        free(self->last_move);
+        self->en_passant_square = (from + to) / 2;
+        self->hash ^= zobrist_en_passant[SQUARE_FILE(self->en_passant_square)];
     }
 
-    self->last_move = malloc(sizeof(ChessMove));
-    *self->last_move = *move;
+    self->turn = !color;
+    self->hash ^= zobrist_black_to_move;
+    self->fullmove_number += color == BLACK;
 }
 
-void chess_board_promote_pawn(ChessBoard *self, ChessPiece *pawn, struct ChessMove *move,
-                              PieceType promoted_type)
+void chess_board_copy_make_move(ChessBoard *self, const ChessBoard *position, ChessMove move)
 {
-    chess_board_make_move(self, pawn, move);
-
-    Vec2i to = move->to;
-    self->squares[to.x][to.y]->type = promoted_type;
+    MoveUndo undo;
+    *self = *position;
+    chess_board_make_move(self, move, &undo);
 }
 
-void chess_board_undo_last_move(ChessBoard *self, ChessMove *prev_last_move)
+void chess_board_promote_pawn(ChessBoard *self, ChessMove move, PieceType promoted_type, MoveUndo *undo)
 {
-    ChessMove *last_move = self->last_move;
-    Vec2i from = last_move->from;
-    Vec2i to = last_move->to;
+    chess_board_make_move(self, move_with_promotion(move, promoted_type), undo);
+}
 
-    ChessPiece *moved_piece = self->squares[to.x][to.y];
+void chess_board_undo_move(ChessBoard *self, const MoveUndo *undo)
+{
+    ChessMove move = undo->move;
+    int from = move_from(move);
+    int to = move_to(move);
+    int rank = SQUARE_RANK(from);
 
-    switch (last_move->type)
+    if (move_is_promotion(move))
     {
-    case EN_PASSANT:
-        self->squares[to.x][from.y] = chess_piece_new(PIECE_PAWN, !self->squares[to.x][to.y]->color);
-        break;
-    case CASTLE_KINGSIDE:
-        self->squares[7][from.y] = self->squares[5][from.y];
-        self->squares[5][from.y] = NULL;
-        break;
-    case CASTLE_QUEENSIDE:
-        self->squares[0][from.y] = self->squares[3][from.y];
-        self->squares[3][from.y] = NULL;
-        break;
-    case PROMOTION:
-        moved_piece->type = PIECE_PAWN; // make it a pawn again
-        break;
+        set_piece_type(self, to, PIECE_PAWN); // make it a pawn again
     }
 
-    self->squares[from.x][from.y] = moved_piece;
-    self->squares[to.x][to.y] = last_move->is_capture && last_move->type != EN_PASSANT
-                                    ? chess_piece_new(last_move->captured_type, !moved_piece->color)
-                                    : NULL;
+    move_piece(self, to, from);
 
-    if (moved_piece->type == PIECE_KING)
+    switch (move_flags(move))
     {
-        if (moved_piece->color == WHITE)
-        {
-            self->white_king_pos = from;
-        }
-        else
+    case MOVE_EN_PASSANT:
+        put_piece(self, SQUARE_INDEX(SQUARE_FILE(to), rank), PIECE_PAWN, PIECE_CODE_COLOR(undo->captured));
+        break;
+    case MOVE_CASTLE_KINGSIDE:
+        move_piece(self, SQUARE_INDEX(5, rank), SQUARE_INDEX(7, rank));
+        break;
+    case MOVE_CASTLE_QUEENSIDE:
+        move_piece(self, SQUARE_INDEX(3, rank), SQUARE_INDEX(0, rank));
+        break;
+    default:
+        if (undo->captured != PIECE_CODE_NONE)
         {
-            self->black_king_pos = from;
+            put_piece(self, to, PIECE_CODE_TYPE(undo->captured), PIECE_CODE_COLOR(undo->captured));
         }
+        break;
     }
 
-    // restore castling rights
-    CastlingRightsRemoved removed_rights = last_move->castling_rights_removed;
-    if (removed_rights != CASTLING_RIGHT_NONE)
+    uint8_t moved_piece = self->mailbox[from];
+    if (PIECE_CODE_TYPE(moved_piece) == PIECE_KING)
     {
-        update_castling_rights(self, moved_piece->color, removed_rights, true);
+        set_king_pos(self, PIECE_CODE_COLOR(moved_piece), from);
     }
 
-    // restore castling rights removed when a rook is captured
-    CastlingRightsRemoved opp_castling_rights_removed = last_move->opponent_castling_rights_removed;
-    if (opp_castling_rights_removed != CASTLING_RIGHT_NONE)
+    self->castling_rights = undo->castling_rights;
+    self->en_passant_square = undo->en_passant_square;
+    self->turn = PIECE_CODE_COLOR(moved_piece);
+    self->halfmove_clock = undo->halfmove_clock;
+    self->fullmove_number -= self->turn == BLACK;
+    self->hash = undo->hash;
+}
+
+bool chess_board_is_square_attacked(const ChessBoard *self, Vec2i square, ChessColor color)
+{
+    // look outward from the square for each kind of attacker instead of generating the attackers' moves
+    ChessColor attacker = !color;
+    int target = square_from_vec(square);
+
+    // leapers attack the square from the squares a leaper of the defending color would attack from it
+    Bitboard leapers = (attacks_pawn(target, color) & self->pieces[PIECE_PAWN]) |
+                       (attacks_knight(target) & self->pieces[PIECE_KNIGHT]) |
+                       (attacks_king(target) & self->pieces[PIECE_KING]);
+    if (leapers & self->colors[attacker])
     {
-        update_castling_rights(self, !moved_piece->color, opp_castling_rights_removed, true);
+        return true;
     }
 
-    if (self->last_move != NULL)
+    // sliders, the magic lookup stops every ray at its first blocker
+    Bitboard occupancy = chess_board_occupancy(self);
+    Bitboard queens = chess_board_pieces(self, PIECE_QUEEN, attacker);
+
+    if (attacks_bishop(target, occupancy) & (chess_board_pieces(self, PIECE_BISHOP, attacker) | queens))
     {
-        free(self->last_move);
+        return true;
     }
-
-    self->last_move = prev_last_move; // restore the previous last move
+    return attacks_rook(target, occupancy) & (chess_board_pieces(self, PIECE_ROOK, attacker) | queens);
 }
 
-bool chess_board_is_square_attacked(ChessBoard *self, Vec2i square, ChessColor color)
+Bitboard chess_board_attackers(const ChessBoard *self, int square, Bitboard occupancy, ChessColor attacker)
 {
-    // TODO: optimize this
+    Bitboard attackers = (attacks_pawn(square, !attacker) & self->pieces[PIECE_PAWN]) |
+                         (attacks_knight(square) & self->pieces[PIECE_KNIGHT]) |
+                         (attacks_king(square) & self->pieces[PIECE_KING]);
 
-    for (int i = 0; i < 8; i++)
+    Bitboard queens = self->pieces[PIECE_QUEEN];
+    attackers |= attacks_bishop(square, occupancy) & (self->pieces[PIECE_BISHOP] | queens);
+    attackers |= attacks_rook(square, occupancy) & (self->pieces[PIECE_ROOK] | queens);
+
+    return attackers & self->colors[attacker] & occupancy;
+}
+
+Bitboard chess_board_attacked_squares(const ChessBoard *self, Bitboard occupancy, ChessColor attacker)
+{
+    Bitboard own = self->colors[attacker];
+    Bitboard pawns = self->pieces[PIECE_PAWN] & own;
+    Bitboard knights = self->pieces[PIECE_KNIGHT] & own;
+    Bitboard queens = self->pieces[PIECE_QUEEN] & own;
+
+    Bitboard attacked = attacker == WHITE ? ((pawns << 9) & ~FILE_A_BB) | ((pawns << 7) & ~FILE_H_BB)
+                                          : ((pawns >> 7) & ~FILE_A_BB) | ((pawns >> 9) & ~FILE_H_BB);
+    while (knights)
     {
-        for (int j = 0; j < 8; j++)
-        {
-            ChessPiece *piece = self->squares[i][j];
-            if (piece != NULL && piece->color != color)
-            {
-                MoveList move_list = generate_pseudo_legal_moves(piece, (Vec2i){i, j}, self, true);
-                for (int k = 0; k < move_list.n_moves; k++)
-                {
-                    if (move_list.moves[k].to.x == square.x && move_list.moves[k].to.y == square.y)
-                    {
-                        return true;
-                    }
-                }
-                free(move_list.moves);
-            }
-        }
+        attacked |= attacks_knight(bb_pop_lsb(&knights));
     }
-    return false;
+    attacked |= attacks_king(bb_lsb(self->pieces[PIECE_KING] & own));
+
+    // every slider at once, the set-wise kernel is picked at startup
+    attacked |= attacks_sliders((self->pieces[PIECE_BISHOP] & own) | queens,
+                                (self->pieces[PIECE_ROOK] & own) | queens, occupancy);
+
+    return attacked;
 }
 
-bool chess_board_is_in_check(ChessBoard *self, ChessColor color)
+bool chess_board_is_in_check(const ChessBoard *self, ChessColor color)
 {
     Vec2i king_pos = color == WHITE ? self->white_king_pos : self->black_king_pos;
     return chess_board_is_square_attacked(self, king_pos, color);
 }
 
-bool chess_board_does_side_have_legal_moves(ChessBoard *self, ChessColor color)
+bool chess_board_does_side_have_legal_moves(const ChessBoard *self, ChessColor color)
 {
-    for (int i = 0; i < 8; i++)
+    ChessMove buffer[MAX_MOVES];
+    MoveList move_list = move_list_from_buffer(buffer);
+
+    // the generators move the side to move, so ask the other side on a copy with the turn handed over. its
+    // en passant square belonged to the side to move and is dropped
+    if (color != self->turn)
     {
-        for (int j = 0; j < 8; j++)
-        {
-            ChessPiece *piece = self->squares[i][j];
-            if (piece != NULL && piece->color == color)
-            {
-                MoveList move_list = generate_legal_moves(piece, (Vec2i){i, j}, self);
-                if (move_list.n_moves > 0)
-                {
-                    return true;
-                }
-                free(move_list.moves);
-            }
-        }
+        ChessBoard position = *self;
+        position.turn = color;
+        position.en_passant_square = NO_SQUARE;
+
+        generate_all_legal_moves(&position, &move_list);
+        return move_list.n_moves > 0;
     }
-    return false;
+
+    generate_all_legal_moves(self, &move_list);
+    return move_list.n_moves > 0;
 }
 
-bool chess_board_is_in_checkmate(ChessBoard *self, ChessColor color, bool do_check_detection)
+bool chess_board_is_in_checkmate(const ChessBoard *self, ChessColor color, bool do_check_detection)
 {
     if (do_check_detection && !chess_board_is_in_check(self, color))
     {
@@ -274,7 +294,7 @@ bool chess_board_is_in_checkmate(ChessBoard *self, ChessColor color, bool do_che
     return !chess_board_does_side_have_legal_moves(self, color);
 }
 
-bool chess_board_is_in_stalemate(ChessBoard *self, ChessColor color, bool do_check_detection)
+bool chess_board_is_in_stalemate(const ChessBoard *self, ChessColor color, bool do_check_detection)
 {
     if (do_check_detection && chess_board_is_in_check(self, color))
     {
@@ -284,101 +304,521 @@ bool chess_board_is_in_stalemate(ChessBoard *self, ChessColor color, bool do_che
     return !chess_board_does_side_have_legal_moves(self, color);
 }
 
-//Initializing board from a FEN string.
-void chess_board_from_fen(ChessBoard *self, const char *fen)
+int chess_board_count_repetitions(const ChessBoard *self, const MoveUndo *undos, int n_undos)
 {
-    //To initialize the board to empty
-     for (int i = 0; i < 8; i++) 
-        for (int j = 0; j < 8; j++) 
-            self->squares[i][j] = NULL;
-
-    // Split the FEN string into relevant parts (board, turn, castling rights)
-    char board_part[100], turn_part[10], castling_part[10], en_passant_part[10], halfmove_clock[10], fullmove_number[10];
-    sscanf(fen, "%s %s %s %s %s %s", board_part, turn_part, castling_part, en_passant_part, halfmove_clock, fullmove_number);
-
-    // Parse board part of FEN
-    int row = 7, col = 0;
-    for (const char *c = board_part; *c != '\0'; c++) {
-        if (*c == '/') {
-            row--;
-            col = 0;
-        } else if (isdigit(*c)) {
-            col += *c - '0';
-        } else {
-            ChessColor color = isupper(*c) ? WHITE : BLACK;
-            char piece = tolower(*c);
+    // undos[i].hash is the position before move i, the same side was to move 2, 4, ... plies ago
+    int n_repetitions = 0;
+    int max_plies = self->halfmove_clock < n_undos ? self->halfmove_clock : n_undos;
+
+    for (int plies = 4; plies <= max_plies; plies += 2)
+    {
+        n_repetitions += undos[n_undos - plies].hash == self->hash;
+    }
+
+    return n_repetitions;
+}
+
+bool chess_board_is_fifty_move_draw(const ChessBoard *self) { return self->halfmove_clock >= 100; }
+
+// no sequence of legal moves can end in mate: bare kings, a single minor piece, or any number of bishops
+// that all stand on squares of one color
+bool chess_board_is_insufficient_material(const ChessBoard *self)
+{
+    const uint64_t mating_material =
+        MATERIAL_MASK(MATERIAL_PAWN) | MATERIAL_MASK(MATERIAL_ROOK) | MATERIAL_MASK(MATERIAL_QUEEN);
+    if (self->material & mating_material)
+    {
+        return false;
+    }
+
+    int knights = chess_board_material_count(self, MATERIAL_KNIGHT, WHITE) +
+                  chess_board_material_count(self, MATERIAL_KNIGHT, BLACK);
+    int light_bishops = chess_board_material_count(self, MATERIAL_LIGHT_BISHOP, WHITE) +
+                        chess_board_material_count(self, MATERIAL_LIGHT_BISHOP, BLACK);
+    int dark_bishops = chess_board_material_count(self, MATERIAL_DARK_BISHOP, WHITE) +
+                       chess_board_material_count(self, MATERIAL_DARK_BISHOP, BLACK);
+
+    return knights + light_bishops + dark_bishops <= 1 ||
+           (knights == 0 && (light_bishops == 0 || dark_bishops == 0));
+}
+
+static inline bool is_blank(char c) { return c == ' ' || c == '\t'; }
+
+static inline bool is_field_end(char c) { return is_blank(c) || c == '\0' || c == '\n' || c == '\r'; }
+
+static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static const char *skip_blanks(const char *c)
+{
+    while (is_blank(*c))
+    {
+        c++;
+    }
+    return c;
+}
+
+// start of the field after the one ending at c, NULL if the line ends first
+static const char *next_field(const char *c)
+{
+    c = skip_blanks(c);
+    return is_field_end(*c) ? NULL : c;
+}
+
+// reads a move counter, NULL if it does not fit or runs into something other than the end of the field
+static const char *parse_counter(const char *c, uint16_t *counter)
+{
+    unsigned value = 0;
+
+    for (; is_digit(*c); c++)
+    {
+        value = value * 10 + (*c - '0');
+        if (value > UINT16_MAX)
+        {
+            return NULL;
+        }
+    }
+
+    *counter = value;
+    return is_field_end(*c) ? c : NULL;
+}
+
+FenError chess_board_from_fen(ChessBoard *self, const char *fen)
+{
+    ChessBoard board;
+    const char *end;
+    FenError error = chess_board_parse_fen(&board, fen, &end);
+
+    if (error != FEN_OK)
+    {
+        return error;
+    }
+
+    // trailing whitespace is fine, so lines read with fgets can be passed as they are
+    while (is_field_end(*end) && *end != '\0')
+    {
+        end++;
+    }
+    if (*end != '\0')
+    {
+        return FEN_ERROR_TRAILING;
+    }
+
+    *self = board;
+    return FEN_OK;
+}
+
+// a single walk over the string, every field is checked as it is read
+FenError chess_board_parse_fen(ChessBoard *self, const char *fen, const char **end)
+{
+    ChessBoard board;
+    const char *c = skip_blanks(fen);
+    int n_kings[2] = {0, 0};
+
+    clear_board(&board);
+
+    // piece placement, from rank 8 down to rank 1
+    for (int y = 7; y >= 0; y--)
+    {
+        for (int x = 0; x < 8;)
+        {
+            if (*c >= '1' && *c <= '8' - x)
+            {
+                x += *c++ - '0';
+                continue;
+            }
+
             PieceType type;
+            ChessColor color = *c >= 'a' ? BLACK : WHITE;
+            switch (*c | 0x20)
+            {
+            case 'p': type = PIECE_PAWN; break;
+            case 'n': type = PIECE_KNIGHT; break;
+            case 'b': type = PIECE_BISHOP; break;
+            case 'r': type = PIECE_ROOK; break;
+            case 'q': type = PIECE_QUEEN; break;
+            case 'k': type = PIECE_KING; break;
+            default: return FEN_ERROR_BOARD; // unknown character, short rank or a rank of more than 8 squares
+            }
 
-            switch (piece) {
-                case 'p': type = PIECE_PAWN; break;
-                case 'r': type = PIECE_ROOK; break;
-                case 'n': type = PIECE_KNIGHT; break;
-                case 'b': type = PIECE_BISHOP; break;
-                case 'q': type = PIECE_QUEEN; break;
-                case 'k': type = PIECE_KING; 
-                    if (color == WHITE) {
-                        self->white_king_pos = (Vec2i){col, row};
-                    } else {
-                        self->black_king_pos = (Vec2i){col, row};
-                    }
-                    break;
+            if (type == PIECE_PAWN && (y == 0 || y == 7))
+            {
+                return FEN_ERROR_PAWN_RANK;
             }
-            self->squares[col][row] = chess_piece_new(type, color);
-            col++;
+            if (type == PIECE_KING)
+            {
+                n_kings[color]++;
+                set_king_pos(&board, color, SQUARE_INDEX(x, y));
+            }
+
+            put_piece(&board, SQUARE_INDEX(x, y), type, color);
+            x++;
+            c++;
+        }
+
+        if (y > 0 && *c++ != '/')
+        {
+            return FEN_ERROR_BOARD;
         }
     }
 
-    // Parse turn
-    parse_turn(self, turn_part);
+    if (!is_field_end(*c))
+    {
+        return FEN_ERROR_BOARD;
+    }
+    if (n_kings[WHITE] != 1 || n_kings[BLACK] != 1)
+    {
+        return FEN_ERROR_KINGS;
+    }
+    if (!is_material_reachable(&board, WHITE) || !is_material_reachable(&board, BLACK))
+    {
+        return FEN_ERROR_MATERIAL;
+    }
+
+    // side to move
+    if ((c = next_field(c)) == NULL)
+    {
+        return FEN_ERROR_MISSING_FIELD;
+    }
+    if ((*c != 'w' && *c != 'b') || !is_field_end(c[1]))
+    {
+        return FEN_ERROR_TURN;
+    }
+    board.turn = *c++ == 'w' ? WHITE : BLACK;
 
-    // Parse castling rights
-    parse_castling_rights(self, castling_part);
-}
+    // castling rights, each one needs its king and rook on their starting squares
+    if ((c = next_field(c)) == NULL)
+    {
+        return FEN_ERROR_MISSING_FIELD;
+    }
+    if (*c == '-')
+    {
+        c++;
+    }
+    else
+    {
+        for (; !is_field_end(*c); c++)
+        {
+            ChessColor color = *c >= 'a' ? BLACK : WHITE;
+            int y = color == WHITE ? 0 : 7;
+            int rook_x;
+            CastlingRights right;
+
+            switch (*c)
+            {
+            case 'K': right = CASTLE_WHITE_KING_SIDE, rook_x = 7; break;
+            case 'Q': right = CASTLE_WHITE_QUEEN_SIDE, rook_x = 0; break;
+            case 'k': right = CASTLE_BLACK_KING_SIDE, rook_x = 7; break;
+            case 'q': right = CASTLE_BLACK_QUEEN_SIDE, rook_x = 0; break;
+            default: return FEN_ERROR_CASTLING;
+            }
+
+            bool already_set = board.castling_rights & right;
+            board.castling_rights |= right;
+
+            if (already_set || board.mailbox[SQUARE_INDEX(4, y)] != PIECE_CODE(PIECE_KING, color) ||
+                board.mailbox[SQUARE_INDEX(rook_x, y)] != PIECE_CODE(PIECE_ROOK, color))
+            {
+                return FEN_ERROR_CASTLING;
+            }
+        }
+    }
+    if (!is_field_end(*c))
+    {
+        return FEN_ERROR_CASTLING;
+    }
+
+    // en passant target, only behind a pawn that can just have made a double push. it is dropped, as after a
+    // double push in make, when no pawn can take it
+    if ((c = next_field(c)) == NULL)
+    {
+        return FEN_ERROR_MISSING_FIELD;
+    }
+    if (*c == '-')
+    {
+        c++;
+    }
+    else
+    {
+        int x = c[0] - 'a', y = c[1] - '1';
+        int pawn_y = board.turn == WHITE ? 4 : 3;
 
-    // Parse the active color (turn)
-    static void parse_turn(ChessBoard *self, const char *fen_turn) {
-        if (fen_turn[0] == 'w') {
-            self->turn = WHITE;
-        } else {
-            self->turn = BLACK;
+        if (x < 0 || x >= 8 || y != (board.turn == WHITE ? 5 : 2) ||
+            board.mailbox[SQUARE_INDEX(x, pawn_y)] != PIECE_CODE(PIECE_PAWN, !board.turn) ||
+            board.mailbox[SQUARE_INDEX(x, y)] != PIECE_CODE_NONE ||
+            board.mailbox[SQUARE_INDEX(x, 2 * y - pawn_y)] != PIECE_CODE_NONE)
+        {
+            return FEN_ERROR_EN_PASSANT;
+        }
+        if (can_capture_en_passant(&board, SQUARE_INDEX(x, y), board.turn))
+        {
+            board.en_passant_square = SQUARE_INDEX(x, y);
         }
+        c += 2;
+    }
+    if (!is_field_end(*c))
+    {
+        return FEN_ERROR_EN_PASSANT;
     }
 
-    // Parse castling rights
-    static void parse_castling_rights(ChessBoard *self, const char *fen_castling) {
-        self->castling_rights = (CastlingRights){0, 0, 0, 0}; // Initialize to no castling
+    // the move counters are optional, EPD lines go straight on to their operations
+    const char *next = skip_blanks(c);
+    if (is_digit(*next))
+    {
+        if ((c = parse_counter(next, &board.halfmove_clock)) == NULL)
+        {
+            return FEN_ERROR_COUNTERS;
+        }
 
-        for (const char *c = fen_castling; *c != '\0'; c++) {
-            switch (*c) {
-                case 'K': self->castling_rights.white_king_side = 1; break;
-                case 'Q': self->castling_rights.white_queen_side = 1; break;
-                case 'k': self->castling_rights.black_king_side = 1; break;
-                case 'q': self->castling_rights.black_queen_side = 1; break;
+        next = skip_blanks(c);
+        if (is_digit(*next))
+        {
+            if ((c = parse_counter(next, &board.fullmove_number)) == NULL)
+            {
+                return FEN_ERROR_COUNTERS;
+            }
+            if (board.fullmove_number == 0)
+            {
+                board.fullmove_number = 1;
             }
         }
+    }
 
-      
-    static void update_castling_rights(ChessBoard *self, ChessColor color, CastlingRightsRemoved removed_rights,
-                                       bool restore_rights)
+    // the side that just moved can't have left its king in check
+    if (chess_board_is_in_check(&board, !board.turn))
     {
-        bool new_state = restore_rights ? 1 : 0;
-    
-        if (removed_rights == CASTLING_RIGHT_KINGSIDE)
+        return FEN_ERROR_ILLEGAL;
+    }
+
+    // put_piece has already hashed the pieces in, only the state keys are missing
+    board.hash ^= zobrist_castling_key(board.castling_rights);
+    if (board.en_passant_square != NO_SQUARE)
+    {
+        board.hash ^= zobrist_en_passant[SQUARE_FILE(board.en_passant_square)];
+    }
+    if (board.turn == BLACK)
+    {
+        board.hash ^= zobrist_black_to_move;
+    }
+    *self = board;
+    if (end != NULL)
+    {
+        *end = c;
+    }
+    return FEN_OK;
+}
+
+int chess_board_to_fen(const ChessBoard *self, char *out)
+{
+    static const char piece_chars[2][N_PIECE_TYPES] = {{'p', 'n', 'b', 'r', 'k', 'q'},
+                                                       {'P', 'N', 'B', 'R', 'K', 'Q'}};
+    char *c = out;
+
+    for (int y = 7; y >= 0; y--)
+    {
+        int n_empty = 0;
+
+        for (int x = 0; x < 8; x++)
         {
-            color == WHITE ? (self->castling_rights.white_king_side = new_state)
-                           : (self->castling_rights.black_king_side = new_state);
+            uint8_t code = self->mailbox[SQUARE_INDEX(x, y)];
+
+            if (code == PIECE_CODE_NONE)
+            {
+                n_empty++;
+                continue;
+            }
+            if (n_empty > 0)
+            {
+                *c++ = '0' + n_empty;
+                n_empty = 0;
+            }
+            *c++ = piece_chars[PIECE_CODE_COLOR(code)][PIECE_CODE_TYPE(code)];
         }
-        else if (removed_rights == CASTLING_RIGHT_QUEENSIDE)
+
+        if (n_empty > 0)
         {
-            color == WHITE ? (self->castling_rights.white_queen_side = new_state)
-                           : (self->castling_rights.black_queen_side = new_state);
+            *c++ = '0' + n_empty;
         }
-        else if (removed_rights == CASTLING_RIGHT_BOTH)
+        *c++ = y > 0 ? '/' : ' ';
+    }
+
+    *c++ = self->turn == WHITE ? 'w' : 'b';
+    *c++ = ' ';
+
+    const char *castling = c;
+    for (int i = 0; i < 4; i++)
+    {
+        if (self->castling_rights & (1 << i))
         {
-            color == WHITE ? (self->castling_rights.white_king_side = new_state,
-                              self->castling_rights.white_queen_side = new_state)
-                           : (self->castling_rights.black_king_side = new_state,
-                              self->castling_rights.black_queen_side = new_state);
+            *c++ = "KQkq"[i];
         }
     }
+    if (c == castling)
+    {
+        *c++ = '-';
+    }
+    *c++ = ' ';
+
+    if (self->en_passant_square != NO_SQUARE)
+    {
+        *c++ = 'a' + SQUARE_FILE(self->en_passant_square);
+        *c++ = '1' + SQUARE_RANK(self->en_passant_square);
+    }
+    else
+    {
+        *c++ = '-';
+    }
+
+    c += sprintf(c, " %u %u", self->halfmove_clock, self->fullmove_number);
+    return c - out;
+}
+
+const char *fen_error_string(FenError error)
+{
+    switch (error)
+    {
+    case FEN_OK: return "ok";
+    case FEN_ERROR_BOARD: return "invalid piece placement";
+    case FEN_ERROR_KINGS: return "each side needs exactly one king";
+    case FEN_ERROR_PAWN_RANK: return "pawn on the first or last rank";
+    case FEN_ERROR_MATERIAL: return "more pieces than eight pawns can promote to";
+    case FEN_ERROR_MISSING_FIELD: return "missing field";
+    case FEN_ERROR_TURN: return "invalid side to move";
+    case FEN_ERROR_CASTLING: return "invalid castling rights";
+    case FEN_ERROR_EN_PASSANT: return "invalid en passant square";
+    case FEN_ERROR_COUNTERS: return "invalid move counters";
+    case FEN_ERROR_ILLEGAL: return "side not to move is in check";
+    case FEN_ERROR_TRAILING: return "unexpected characters after the fen";
+    }
+    return "unknown error";
+}
+
+// the en passant square is only kept, and hashed, when a pawn of the capturer stands next to the pushed pawn.
+// otherwise the position after a double push would never repeat one reached by other moves
+static bool can_capture_en_passant(const ChessBoard *self, int square, ChessColor capturer)
+{
+    return attacks_pawn(square, !capturer) & chess_board_pieces(self, PIECE_PAWN, capturer);
+}
+
+// at most eight pawns, and every piece beyond the starting set must be one of them promoted
+static bool is_material_reachable(const ChessBoard *self, ChessColor color)
+{
+    static const int starting_counts[6] = {0, 2, 2, 2, 1, 1}; // indexed by PieceType, pawns count on their own
+    int n_pawns = bb_popcount(chess_board_pieces(self, PIECE_PAWN, color));
+    int n_promoted = 0;
+
+    for (PieceType type = PIECE_KNIGHT; type <= PIECE_QUEEN; type++)
+    {
+        int extra = bb_popcount(chess_board_pieces(self, type, color)) - starting_counts[type];
+        n_promoted += extra > 0 ? extra : 0;
+    }
+
+    return n_pawns + n_promoted <= 8;
+}
+
+static void clear_board(ChessBoard *self)
+{
+    for (int i = 0; i < N_PIECE_TYPES; i++)
+    {
+        self->pieces[i] = 0;
+    }
+    self->colors[WHITE] = 0;
+    self->colors[BLACK] = 0;
+
+    for (int i = 0; i < 64; i++)
+    {
+        self->mailbox[i] = PIECE_CODE_NONE;
+    }
+
+    self->castling_rights = 0;
+    self->en_passant_square = NO_SQUARE;
+    self->turn = WHITE;
+    self->halfmove_clock = 0;
+    self->fullmove_number = 1;
+    self->hash = 0;
+    self->material = 0;
+}
+
+// places a new piece on an empty square
+static void put_piece(ChessBoard *self, int square, PieceType type, ChessColor color)
+{
+    Bitboard bb = SQUARE_BB(square);
+
+    self->pieces[type] |= bb;
+    self->colors[color] |= bb;
+    self->mailbox[square] = PIECE_CODE(type, color);
+    self->hash ^= zobrist_pieces[PIECE_CODE(type, color)][square];
+    self->material += material_delta(PIECE_CODE(type, color), square);
+}
+
+// removes the piece standing on square
+static void remove_piece(ChessBoard *self, int square)
+{
+    uint8_t code = self->mailbox[square];
+    Bitboard bb = SQUARE_BB(square);
+
+    self->pieces[PIECE_CODE_TYPE(code)] &= ~bb;
+    self->colors[PIECE_CODE_COLOR(code)] &= ~bb;
+    self->mailbox[square] = PIECE_CODE_NONE;
+    self->hash ^= zobrist_pieces[code][square];
+    self->material -= material_delta(code, square);
+}
+
+// moves a piece to an empty square
+static void move_piece(ChessBoard *self, int from, int to)
+{
+    uint8_t code = self->mailbox[from];
+    Bitboard from_to = SQUARE_BB(from) | SQUARE_BB(to);
+
+    self->pieces[PIECE_CODE_TYPE(code)] ^= from_to;
+    self->colors[PIECE_CODE_COLOR(code)] ^= from_to;
+    self->mailbox[from] = PIECE_CODE_NONE;
+    self->mailbox[to] = code;
+    self->hash ^= zobrist_pieces[code][from] ^ zobrist_pieces[code][to];
+}
+
+// changes the type of the piece on square in place (promotion)
+static void set_piece_type(ChessBoard *self, int square, PieceType type)
+{
+    uint8_t code = self->mailbox[square];
+    Bitboard bb = SQUARE_BB(square);
+
+    self->pieces[PIECE_CODE_TYPE(code)] &= ~bb;
+    self->pieces[type] |= bb;
+    self->mailbox[square] = PIECE_CODE(type, PIECE_CODE_COLOR(code));
+    self->hash ^= zobrist_pieces[code][square] ^ zobrist_pieces[self->mailbox[square]][square];
+    self->material += material_delta(self->mailbox[square], square) - material_delta(code, square);
+}
+
+static void set_king_pos(ChessBoard *self, ChessColor color, int square)
+{
+    if (color == WHITE)
+    {
+        self->white_king_pos = square_to_vec(square);
+    }
+    else
+    {
+        self->black_king_pos = square_to_vec(square);
+    }
+}
+
+// the material signature count a piece adds, bishops never change square color so moves need no update
+static uint64_t material_delta(uint8_t code, int square)
+{
+    static const int kinds[N_PIECE_TYPES] = {MATERIAL_PAWN, MATERIAL_KNIGHT, MATERIAL_LIGHT_BISHOP,
+                                             MATERIAL_ROOK, -1, MATERIAL_QUEEN};
+    PieceType type = PIECE_CODE_TYPE(code);
+
+    if (type == PIECE_KING)
+    {
+        return 0;
+    }
+
+    // a1 is a dark square, as is every square whose file and rank add up to an even number
+    int kind = kinds[type];
+    if (type == PIECE_BISHOP && (SQUARE_FILE(square) + SQUARE_RANK(square)) % 2 == 0)
+    {
+        kind = MATERIAL_DARK_BISHOP;
+    }
+
+    return 1ULL << MATERIAL_SHIFT(kind, PIECE_CODE_COLOR(code));
 }
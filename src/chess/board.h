@@ -4,40 +4,153 @@
 #include <stdbool.h>
 
 #include "../types.h"
+#include "bitboard.h"
+#include "move.h"
 #include "piece.h"
 
-// forward declaration to avoid circular dependency
-struct ChessMove;
+#define NO_SQUARE -1
 
-typedef struct
+// buffer size that holds any fen written by chess_board_to_fen, terminator included
+#define FEN_MAX_LENGTH 96
+
+typedef enum
+{
+    FEN_OK,
+    FEN_ERROR_BOARD,
+    FEN_ERROR_KINGS,
+    FEN_ERROR_PAWN_RANK,
+    FEN_ERROR_MATERIAL,
+    FEN_ERROR_MISSING_FIELD,
+    FEN_ERROR_TURN,
+    FEN_ERROR_CASTLING,
+    FEN_ERROR_EN_PASSANT,
+    FEN_ERROR_COUNTERS,
+    FEN_ERROR_ILLEGAL,
+    FEN_ERROR_TRAILING,
+} FenError;
+
+// castling rights as four bits, the value doubles as the index of their zobrist key
+typedef uint8_t CastlingRights;
+
+enum
+{
+    CASTLE_WHITE_KING_SIDE = 1,
+    CASTLE_WHITE_QUEEN_SIDE = 2,
+    CASTLE_BLACK_KING_SIDE = 4,
+    CASTLE_BLACK_QUEEN_SIDE = 8,
+    CASTLE_ALL = 15,
+};
+
+// kinds of pieces counted by the material signature, bishops split by the color of their square
+typedef enum
 {
-    bool white_king_side : 1;
-    bool white_queen_side : 1;
-    bool black_king_side : 1;
-    bool black_queen_side : 1;
-} CastlingRights;
+    MATERIAL_PAWN,
+    MATERIAL_KNIGHT,
+    MATERIAL_LIGHT_BISHOP,
+    MATERIAL_DARK_BISHOP,
+    MATERIAL_ROOK,
+    MATERIAL_QUEEN,
+    N_MATERIAL_KINDS,
+} MaterialKind;
 
+// bit offset of the 4 bit count of one kind and color in the material signature, kings are not counted. the
+// fen parser refuses material that eight promotions can't reach, so no count goes past 10
+#define MATERIAL_SHIFT(kind, color) (((color) * N_MATERIAL_KINDS + (kind)) * 4)
+// the counts of a kind for both colors
+#define MATERIAL_MASK(kind) \
+    ((0xFULL << MATERIAL_SHIFT(kind, WHITE)) | (0xFULL << MATERIAL_SHIFT(kind, BLACK)))
+
+// the whole position by value with no pointers, so a plain assignment or memcpy is a complete copy
 typedef struct
 {
-    ChessPiece *squares[8][8];
-    struct ChessMove *last_move;
+    Bitboard pieces[N_PIECE_TYPES]; // squares occupied by each piece type, both colors
+    Bitboard colors[2];             // squares occupied by each color
+    uint8_t mailbox[64];            // PIECE_CODE of every square, indexed by SQUARE_INDEX
+
     CastlingRights castling_rights;
+    int8_t en_passant_square; // square a pawn can capture onto en passant, NO_SQUARE if none
 
     Vec2i white_king_pos;
     Vec2i black_king_pos;
     ChessColor turn;
+    uint16_t halfmove_clock;  // plies since the last capture or pawn move
+    uint16_t fullmove_number; // starts at 1, incremented after every black move
+    uint64_t hash;            // zobrist hash of the position, kept up to date by make and undo
+    uint64_t material;        // material signature, piece counts packed by MATERIAL_SHIFT
 } ChessBoard;
 
+// keeps board copies (perft workers, copy-make, snapshots) within a few cache lines
+_Static_assert(sizeof(ChessBoard) <= 200, "ChessBoard should stay a small value type");
+
+// everything chess_board_make_move destroys, so a move can be taken back without searching for it.
+// searches keep these on their own stack, one per ply, games in a ChessHistory
+typedef struct
+{
+    ChessMove move;
+    uint8_t captured; // PIECE_CODE of the captured piece, PIECE_CODE_NONE for non captures
+    int8_t en_passant_square;
+    CastlingRights castling_rights;
+    uint16_t halfmove_clock;
+    uint64_t hash;
+} MoveUndo;
+
+static inline Bitboard chess_board_occupancy(const ChessBoard *self)
+{
+    return self->colors[WHITE] | self->colors[BLACK];
+}
+
+static inline bool chess_board_is_empty(const ChessBoard *self, Vec2i square)
+{
+    return self->mailbox[square_from_vec(square)] == PIECE_CODE_NONE;
+}
+
+// the piece on an occupied square, by value
+static inline ChessPiece chess_board_piece_at(const ChessBoard *self, Vec2i square)
+{
+    uint8_t code = self->mailbox[square_from_vec(square)];
+    return (ChessPiece){PIECE_CODE_TYPE(code), PIECE_CODE_COLOR(code)};
+}
+
+static inline Bitboard chess_board_pieces(const ChessBoard *self, PieceType type, ChessColor color)
+{
+    return self->pieces[type] & self->colors[color];
+}
+
+static inline int chess_board_material_count(const ChessBoard *self, MaterialKind kind, ChessColor color)
+{
+    return (self->material >> MATERIAL_SHIFT(kind, color)) & 0xF;
+}
+
 void chess_board_init(ChessBoard *self);
-void chess_board_make_move(ChessBoard *self, ChessPiece *piece, struct ChessMove *move);
-void chess_board_promote_pawn(ChessBoard *self, ChessPiece *pawn, struct ChessMove *move,
-                              PieceType promoted_type);
-void chess_board_undo_last_move(ChessBoard *self, struct ChessMove *prev_last_move);
-void chess_board_from_fen(ChessBoard *self, const char *fen);
-bool chess_board_is_square_attacked(ChessBoard *self, Vec2i square, ChessColor color);
-bool chess_board_does_side_have_legal_moves(ChessBoard *self, ChessColor color);
-bool chess_board_is_in_check(ChessBoard *self, ChessColor color);
-bool chess_board_is_in_checkmate(ChessBoard *self, ChessColor color, bool do_check_detection);
-bool chess_board_is_in_stalemate(ChessBoard *self, ChessColor color, bool do_check_detection);
+void chess_board_make_move(ChessBoard *self, ChessMove move, MoveUndo *undo);
+// copy-make: self becomes position with move played, position itself is left untouched and needs no undo
+void chess_board_copy_make_move(ChessBoard *self, const ChessBoard *position, ChessMove move);
+void chess_board_promote_pawn(ChessBoard *self, ChessMove move, PieceType promoted_type, MoveUndo *undo);
+void chess_board_undo_move(ChessBoard *self, const MoveUndo *undo);
+// parses a complete fen, the move counters may be left out. on error self is left untouched
+FenError chess_board_from_fen(ChessBoard *self, const char *fen);
+// parses the fen at the start of a longer string, such as an EPD line, and points end just past the last
+// field read. on error self is left untouched
+FenError chess_board_parse_fen(ChessBoard *self, const char *fen, const char **end);
+// writes the fen of the position to out, which needs FEN_MAX_LENGTH bytes, and returns its length
+int chess_board_to_fen(const ChessBoard *self, char *out);
+const char *fen_error_string(FenError error);
+bool chess_board_is_square_attacked(const ChessBoard *self, Vec2i square, ChessColor color);
+bool chess_board_does_side_have_legal_moves(const ChessBoard *self, ChessColor color);
+// pieces of the attacker color attacking square, with sliders seeing through everything not in occupancy
+Bitboard chess_board_attackers(const ChessBoard *self, int square, Bitboard occupancy, ChessColor attacker);
+
+// every square a piece of the attacker attacks, given the occupancy that blocks the sliders
+Bitboard chess_board_attacked_squares(const ChessBoard *self, Bitboard occupancy, ChessColor attacker);
+bool chess_board_is_in_check(const ChessBoard *self, ChessColor color);
+bool chess_board_is_in_checkmate(const ChessBoard *self, ChessColor color, bool do_check_detection);
+bool chess_board_is_in_stalemate(const ChessBoard *self, ChessColor color, bool do_check_detection);
+// how often the current position occurred before, given the undo records of the moves that led to it
+// (oldest first). only the positions since the last capture or pawn move are compared, so the cost is
+// bounded by the halfmove clock
+int chess_board_count_repetitions(const ChessBoard *self, const MoveUndo *undos, int n_undos);
+bool chess_board_is_fifty_move_draw(const ChessBoard *self);
+// dead position by material alone, read off the material signature in constant time
+bool chess_board_is_insufficient_material(const ChessBoard *self);
 
 #endif
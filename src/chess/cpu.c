@@ -0,0 +1,22 @@
+#include "cpu.h"
+
+unsigned cpu_features(void)
+{
+    unsigned features = 0;
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+
+    // zen 1 and 2 run pext in microcode over the set bits of the mask, slower than a magic multiply
+    if (__builtin_cpu_supports("bmi2") && !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2"))
+    {
+        features |= CPU_BMI2;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        features |= CPU_AVX2;
+    }
+#endif
+
+    return features;
+}
@@ -0,0 +1,14 @@
+#if !defined(CPU_H)
+#define CPU_H
+
+// instruction set extensions the attack kernels can use, as bits of the value returned by cpu_features
+typedef enum
+{
+    CPU_BMI2 = 1, // pext, only reported where it is fast (not on the microcoded AMD Zen 1 and 2)
+    CPU_AVX2 = 2,
+} CpuFeature;
+
+// detects the extensions of the cpu we run on, 0 on targets other than x86-64
+unsigned cpu_features(void);
+
+#endif
@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "epd.h"
+
+static char *next_line(EpdReader *self);
+
+bool epd_reader_open(EpdReader *self, const char *path)
+{
+    self->file = fopen(path, "rb");
+    if (self->file == NULL)
+    {
+        printf("Failed to open file: %s\n", path);
+        return false;
+    }
+
+    // one extra byte to terminate a last line without a newline
+    self->buffer = (char *)malloc(EPD_BUFFER_SIZE + 1);
+    self->start = 0;
+    self->end = 0;
+    self->eof = false;
+    self->line_number = 0;
+    return true;
+}
+
+void epd_reader_close(EpdReader *self)
+{
+    fclose(self->file);
+    free(self->buffer);
+    self->file = NULL;
+    self->buffer = NULL;
+}
+
+int epd_reader_next(EpdReader *self, EpdRecord *record)
+{
+    char *line;
+
+    do
+    {
+        if ((line = next_line(self)) == NULL)
+        {
+            return 0;
+        }
+        line += strspn(line, " \t\r");
+    } while (*line == '\0');
+
+    const char *end;
+    record->line_number = self->line_number;
+    record->error = chess_board_parse_fen(&record->board, line, &end);
+    if (record->error != FEN_OK)
+    {
+        record->operations = NULL;
+        return -1;
+    }
+
+    record->operations = end;
+    return 1;
+}
+
+const char *epd_find_operation(const char *operations, const char *opcode)
+{
+    size_t length = strlen(opcode);
+
+    for (const char *c = operations; *c != '\0';)
+    {
+        c += strspn(c, " \t;");
+        if (strncmp(c, opcode, length) == 0 && (c[length] == ' ' || c[length] == '\t'))
+        {
+            return c + length + strspn(c + length, " \t");
+        }
+
+        // skip to the next operation, semicolons inside quoted operands don't end it
+        bool quoted = false;
+        for (; *c != '\0' && (quoted || *c != ';'); c++)
+        {
+            quoted ^= *c == '"';
+        }
+    }
+
+    return NULL;
+}
+
+// hands out the next line terminated in place, refilling the buffer when only a partial line is left
+static char *next_line(EpdReader *self)
+{
+    for (;;)
+    {
+        char *line = self->buffer + self->start;
+        char *newline = (char *)memchr(line, '\n', self->end - self->start);
+
+        if (newline != NULL || (self->eof && self->start < self->end))
+        {
+            if (newline == NULL)
+            {
+                newline = self->buffer + self->end;
+            }
+            *newline = '\0';
+            if (newline > line && newline[-1] == '\r')
+            {
+                newline[-1] = '\0';
+            }
+            self->start = newline - self->buffer + 1;
+            if (self->start > self->end)
+            {
+                self->start = self->end;
+            }
+            self->line_number++;
+            return line;
+        }
+        if (self->eof)
+        {
+            return NULL;
+        }
+
+        // a line longer than the whole buffer is handed out in pieces
+        if (self->start == 0 && self->end == EPD_BUFFER_SIZE)
+        {
+            self->buffer[self->end] = '\0';
+            self->start = self->end = 0;
+            self->line_number++;
+            return line;
+        }
+
+        // keep the partial line and fill the rest of the buffer behind it
+        memmove(self->buffer, line, self->end - self->start);
+        self->end -= self->start;
+        self->start = 0;
+
+        size_t n_read = fread(self->buffer + self->end, 1, EPD_BUFFER_SIZE - self->end, self->file);
+        self->end += n_read;
+        self->eof = n_read == 0;
+    }
+}
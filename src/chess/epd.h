@@ -0,0 +1,42 @@
+#if !defined(EPD_H)
+#define EPD_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "board.h"
+
+// lines are read in place from a buffer of this size, a longer line is split in two
+#define EPD_BUFFER_SIZE (1 << 20)
+
+// reads EPD files line by line in large chunks, without copying lines or allocating per position
+typedef struct
+{
+    FILE *file;
+    char *buffer;
+    size_t start; // first byte of the buffer not handed out yet
+    size_t end;   // one past the last byte read from the file
+    bool eof;
+    int line_number;
+} EpdReader;
+
+typedef struct
+{
+    ChessBoard board;
+    const char *operations; // rest of the line after the position, valid until the next read
+    int line_number;
+    FenError error; // why the line was rejected, FEN_OK for positions
+} EpdRecord;
+
+bool epd_reader_open(EpdReader *self, const char *path);
+void epd_reader_close(EpdReader *self);
+
+// reads the position on the next non blank line. returns 1 for a position, 0 at the end of the file and -1
+// for a line that is not a valid position, with record->error and record->line_number saying why and where.
+// reading can go on after an invalid line
+int epd_reader_next(EpdReader *self, EpdRecord *record);
+
+// operand of the first operation with the given opcode ("D5" in ";D5 4865609 ;"), NULL if there is none
+const char *epd_find_operation(const char *operations, const char *opcode);
+
+#endif
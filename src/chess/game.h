@@ -7,6 +7,7 @@
 #include "../gfx/texture.h"
 #include "../ui/ui.h"
 #include "board.h"
+#include "history.h"
 #include "movegen.h"
 #include "piece.h"
 
@@ -40,6 +41,9 @@ typedef enum {
     STALEMATE,
     DRAW_BY_AGREEMENT,
     RESIGNATION,
+    REPETITION,
+    FIFTY_MOVE,
+    INSUFFICIENT_MATERIAL,
 } GameEndReason;
 
 typedef void (*GameStateCB)(ChessGame *);
@@ -78,9 +82,11 @@ typedef struct ChessGame
     struct ChessData
     {
         ChessBoard board;
+        ChessHistory history;
         ChessColor player_color; // white = 1, black = 0
         ChessColor current_turn;
-        MoveList current_move_list;
+        MoveList current_move_list; // legal moves of the selected piece, backed by move_buffer
+        ChessMove move_buffer[MAX_MOVES];
         bool is_in_check : 1;
         bool is_game_over : 1;
         GameEndReason game_end_reason; 
@@ -92,19 +98,20 @@ typedef struct ChessGame
         Vec2i board_size;
         Vec2f mouse_pos;
         bool mouse_down;
+        bool history_key_down; // left/right arrow held, takeback and redo fire once per press
 
         struct
         {
-            ChessPiece *animating_piece;
+            bool is_animating;
+            ChessPiece animating_piece; // drawn sliding towards animating_to, where it already stands
             Vec2i animating_from;
             Vec2i animating_to;
             float animation_time;
         } piece_animations[MAX_PIECE_ANIMATIONS];
 
-        ChessPiece *selected_piece;
+        ChessPiece selected_piece; // only valid while selected_square.x != -1
         Vec2i selected_square;
         bool promotion_menu_open;
-        ChessPiece *pawn_to_promote;
         ChessMove *pending_promotion_move;
         Vec2i promotion_menu_pos;
         Vec2i promotion_menu_size;
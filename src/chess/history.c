@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "history.h"
+
+void chess_history_init(ChessHistory *self, int capacity)
+{
+    self->capacity = capacity > 0 ? capacity : CHESS_HISTORY_DEFAULT_CAPACITY;
+    self->records = (MoveUndo *)malloc(self->capacity * sizeof(MoveUndo));
+    self->n_plies = 0;
+    self->n_records = 0;
+}
+
+void chess_history_destroy(ChessHistory *self)
+{
+    free(self->records);
+    self->records = NULL;
+    self->capacity = 0;
+    chess_history_clear(self);
+}
+
+void chess_history_clear(ChessHistory *self)
+{
+    self->n_plies = 0;
+    self->n_records = 0;
+}
+
+bool chess_history_make_move(ChessHistory *self, ChessBoard *board, ChessMove move)
+{
+    if (self->n_plies == self->capacity)
+    {
+        // the old records stay valid if they can't grow
+        MoveUndo *records = (MoveUndo *)realloc(self->records, 2 * self->capacity * sizeof(MoveUndo));
+        if (records == NULL)
+        {
+            printf("Failed to grow the move history past %d plies\n", self->capacity);
+            return false;
+        }
+        self->records = records;
+        self->capacity *= 2;
+    }
+
+    chess_board_make_move(board, move, &self->records[self->n_plies]);
+    self->n_plies++;
+    self->n_records = self->n_plies;
+    return true;
+}
+
+bool chess_history_undo(ChessHistory *self, ChessBoard *board)
+{
+    if (self->n_plies == 0)
+    {
+        return false;
+    }
+
+    self->n_plies--;
+    chess_board_undo_move(board, &self->records[self->n_plies]);
+    return true;
+}
+
+bool chess_history_redo(ChessHistory *self, ChessBoard *board)
+{
+    if (self->n_plies == self->n_records)
+    {
+        return false;
+    }
+
+    // the record still holds the move, making it again refills the rest
+    MoveUndo *record = &self->records[self->n_plies];
+    chess_board_make_move(board, record->move, record);
+    self->n_plies++;
+    return true;
+}
@@ -0,0 +1,39 @@
+#if !defined(HISTORY_H)
+#define HISTORY_H
+
+#include <stdbool.h>
+
+#include "board.h"
+#include "move.h"
+
+// the moves of a game with everything needed to take them back, and the moves taken back since for redo.
+// the records are preallocated and only grow (doubling) when a game outlasts them
+typedef struct
+{
+    MoveUndo *records;
+    int n_plies;   // records[0, n_plies) took the start position to the current one
+    int n_records; // records[n_plies, n_records) were taken back and can be redone
+    int capacity;
+} ChessHistory;
+
+#define CHESS_HISTORY_DEFAULT_CAPACITY 512
+
+void chess_history_init(ChessHistory *self, int capacity);
+void chess_history_destroy(ChessHistory *self);
+void chess_history_clear(ChessHistory *self);
+
+// plays move on board and records it, dropping the moves that could be redone. returns false, without
+// playing it, if the records can't grow to hold it
+bool chess_history_make_move(ChessHistory *self, ChessBoard *board, ChessMove move);
+// takes back the last move, returns false if there is none
+bool chess_history_undo(ChessHistory *self, ChessBoard *board);
+// plays the last move taken back again, returns false if there is none
+bool chess_history_redo(ChessHistory *self, ChessBoard *board);
+
+// threefold repetition, the current position occurred twice before
+static inline bool chess_history_is_repetition(const ChessHistory *self, const ChessBoard *board)
+{
+    return chess_board_count_repetitions(board, self->records, self->n_plies) >= 2;
+}
+
+#endif
@@ -0,0 +1,58 @@
+#if !defined(MOVE_H)
+#define MOVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "piece.h"
+
+// packed move: bits 0-5 from square, bits 6-11 to square, bits 12-15 MoveFlag
+typedef uint16_t ChessMove;
+
+// bit 2 of a flag marks captures, bit 3 promotions, the low two bits of a promotion select the piece
+typedef enum
+{
+    MOVE_QUIET = 0,
+    MOVE_DOUBLE_PUSH = 1,
+    MOVE_CASTLE_KINGSIDE = 2,
+    MOVE_CASTLE_QUEENSIDE = 3,
+    MOVE_CAPTURE = 4,
+    MOVE_EN_PASSANT = 5,
+    MOVE_PROMOTION = 8,
+    MOVE_PROMOTION_CAPTURE = 12,
+} MoveFlag;
+
+// a1a1 can never be played, so the all zero move doubles as "no move"
+#define MOVE_NONE 0
+
+static inline ChessMove move_new(int from, int to, int flags) { return from | (to << 6) | (flags << 12); }
+
+static inline int move_from(ChessMove move) { return move & 63; }
+
+static inline int move_to(ChessMove move) { return (move >> 6) & 63; }
+
+static inline int move_flags(ChessMove move) { return move >> 12; }
+
+static inline bool move_is_capture(ChessMove move) { return move & (MOVE_CAPTURE << 12); }
+
+static inline bool move_is_promotion(ChessMove move) { return move & (MOVE_PROMOTION << 12); }
+
+static inline bool move_is_castle(ChessMove move)
+{
+    return move_flags(move) == MOVE_CASTLE_KINGSIDE || move_flags(move) == MOVE_CASTLE_QUEENSIDE;
+}
+
+static inline PieceType move_promotion_type(ChessMove move)
+{
+    static const PieceType promotion_types[4] = {PIECE_KNIGHT, PIECE_BISHOP, PIECE_ROOK, PIECE_QUEEN};
+    return promotion_types[(move >> 12) & 3];
+}
+
+// replaces the promotion piece of a promotion move
+static inline ChessMove move_with_promotion(ChessMove move, PieceType type)
+{
+    int index = type == PIECE_KNIGHT ? 0 : type == PIECE_BISHOP ? 1 : type == PIECE_ROOK ? 2 : 3;
+    return (move & ~(3 << 12)) | (index << 12);
+}
+
+#endif
@@ -1,483 +1,270 @@
 #include <stdbool.h>
 #include <stddef.h>
-#include <stdlib.h>
 
+#include "attacks.h"
 #include "movegen.h"
 
-MoveList generate_pseudo_legal_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board,
-                                     bool only_attacking)
+static void add_target_moves(MoveList *out, int from, Bitboard targets, const ChessBoard *board);
+static void add_promotions(MoveList *out, int from, int to, int flags);
+
+// attacks of the knight, bishop, rook or queen on from
+static inline Bitboard piece_attacks(const ChessBoard *board, int from, Bitboard occupancy)
 {
-    MoveList moves;
+    switch (PIECE_CODE_TYPE(board->mailbox[from]))
+    {
+    case PIECE_KNIGHT: return attacks_knight(from);
+    case PIECE_BISHOP: return attacks_bishop(from, occupancy);
+    case PIECE_ROOK: return attacks_rook(from, occupancy);
+    default: return attacks_queen(from, occupancy);
+    }
+}
+
+// en passant empties two squares of a rank, which the pin mask cannot express, so look for attacks on the
+// king in the occupancy after the capture instead
+static bool is_en_passant_legal(const ChessBoard *board, int from, int king, ChessColor color)
+{
+    int to = board->en_passant_square;
+    int captured_square = SQUARE_INDEX(SQUARE_FILE(to), SQUARE_RANK(from));
+    Bitboard occupancy = chess_board_occupancy(board) ^ SQUARE_BB(from) ^ SQUARE_BB(to);
+    occupancy ^= SQUARE_BB(captured_square);
+
+    return chess_board_attackers(board, king, occupancy, !color) == 0;
+}
+
+#define COLOR WHITE
+#define COLOR_NAME(name) name##_white
+#include "movegen_template.h"
+#undef COLOR
+#undef COLOR_NAME
 
+#define COLOR BLACK
+#define COLOR_NAME(name) name##_black
+#include "movegen_template.h"
+#undef COLOR
+#undef COLOR_NAME
+
+void generate_pseudo_legal_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board,
+                                 MoveList *out)
+{
     switch (piece->type)
     {
     case PIECE_PAWN:
-        moves = generate_pawn_moves(piece, square, board, only_attacking);
+        generate_pawn_moves(piece, square, board, out);
         break;
     case PIECE_KNIGHT:
-        moves = generate_knight_moves(piece, square, board);
+        generate_knight_moves(piece, square, board, out);
         break;
     case PIECE_BISHOP:
-        moves = generate_bishop_moves(piece, square, board);
+        generate_bishop_moves(piece, square, board, out);
         break;
     case PIECE_ROOK:
-        moves = generate_rook_moves(piece, square, board);
+        generate_rook_moves(piece, square, board, out);
         break;
     case PIECE_QUEEN:
-        moves = generate_queen_moves(piece, square, board);
+        generate_queen_moves(piece, square, board, out);
         break;
     case PIECE_KING:
-        moves = generate_king_moves(piece, square, board, only_attacking);
+        generate_king_moves(piece, square, board, out);
         break;
-    default:
-        moves = (MoveList){NULL, 0};
-    }
-
-    // account for castling rights removed when a rook is captured
-    for (int i = 0; i < moves.n_moves; i++)
-    {
-        ChessMove *move = &moves.moves[i];
-        if (move->is_capture && move->captured_type == PIECE_ROOK)
-        {
-            CastlingRightsRemoved opp_castling_rights_removed = CASTLING_RIGHT_NONE;
-            ChessColor captured_rook_color = !piece->color;
-
-            int x = move->to.x;
-            int y = move->to.y;
-
-            bool is_queen_side_rook = x == 0 && (y == 0 || y == 7);
-            bool is_king_side_rook = x == 7 && (y == 0 || y == 7);
-
-            bool king_side_allowed = captured_rook_color == WHITE ? board->castling_rights.white_king_side
-                                                         : board->castling_rights.black_king_side;
-            bool queen_side_allowed = captured_rook_color == WHITE ? board->castling_rights.white_queen_side
-                                                          : board->castling_rights.black_queen_side;
-
-            if (is_queen_side_rook && queen_side_allowed)
-            {
-                opp_castling_rights_removed = CASTLING_RIGHT_QUEENSIDE;
-            }
-            else if (is_king_side_rook && king_side_allowed)
-            {
-                opp_castling_rights_removed = CASTLING_RIGHT_KINGSIDE;
-            }
-
-            move->opponent_castling_rights_removed = opp_castling_rights_removed;
-        }
     }
+}
 
-    return moves;
+// the color specialized generators, picked once at the top
+void generate_all_legal_moves(const ChessBoard *board, MoveList *out)
+{
+    generate_legal_stage(board, GENERATE_ALL, out);
 }
 
-MoveList generate_legal_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board)
+int count_legal_moves(const ChessBoard *board)
 {
-    MoveList pseudo_legal_moves = generate_pseudo_legal_moves(piece, square, board, false);
-    ChessMove *legal_moves = malloc(pseudo_legal_moves.n_moves * sizeof(ChessMove));
-    int n_legal_moves = 0;
+    return board->turn == WHITE ? count_legal_moves_white(board) : count_legal_moves_black(board);
+}
 
-    for (int i = 0; i < pseudo_legal_moves.n_moves; i++)
+void generate_legal_stage(const ChessBoard *board, GenerateStage stage, MoveList *out)
+{
+    if (board->turn == WHITE)
     {
-        ChessMove *move = &pseudo_legal_moves.moves[i];
-
-        ChessMove *prev_last_move = NULL;
-
-        if (move->type == PROMOTION)
-        {
-            PieceType types_to_check[] = {PIECE_QUEEN, PIECE_KNIGHT};
-            bool is_legal = true;
-
-            for (int j = 0; j < 2; j++)
-            {
-                if (board->last_move != NULL)
-                {
-                    // make a copy of the last move to restore it after testing the move
-                    prev_last_move = malloc(sizeof(ChessMove));
-                    *prev_last_move = *board->last_move;
-                }
-                chess_board_promote_pawn(board, piece, move, types_to_check[j]);
-
-                if (chess_board_is_in_check(board, piece->color))
-                {
-                    is_legal = false;
-                }
-
-                chess_board_undo_last_move(board, prev_last_move);
-
-                if (!is_legal)
-                {
-                    break;
-                }
-            }
-
-            if (is_legal)
-            {
-                legal_moves[n_legal_moves++] = *move;
-            }
-        }
-        else
-        {
-            if (board->last_move != NULL)
-            {
-                // make a copy of the last move to restore it after testing the move
-                prev_last_move = malloc(sizeof(ChessMove));
-                *prev_last_move = *board->last_move;
-            }
-
-            chess_board_make_move(board, piece, move);
-
-            if (!chess_board_is_in_check(board, piece->color))
-            {
-                legal_moves[n_legal_moves++] = *move;
-            }
-
-            chess_board_undo_last_move(board, prev_last_move);
-        }
+        generate_legal_stage_white(board, stage, out);
+    }
+    else
+    {
+        generate_legal_stage_black(board, stage, out);
     }
-
-    free(pseudo_legal_moves.moves);
-
-    return (MoveList){legal_moves, n_legal_moves};
 }
 
-MoveList generate_pawn_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board,
-                             bool only_attacking)
+void generate_legal_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out)
 {
-    ChessMove *moves = malloc(MAX_PAWN_MOVES * sizeof(ChessMove));
-
-    bool is_white = piece->color == WHITE;
-    int direction = is_white ? 1 : -1;
-    bool is_on_starting_rank = is_white ? square.y == 1 : square.y == 6;
-    bool is_on_promotion_rank = is_white ? square.y == 6 : square.y == 1;
-
-    int n_moves = 0;
+    LegalMasks masks;
+    legal_masks_init(&masks, board, piece->color);
+    generate_legal_moves_masked(piece, square, board, &masks, out);
+}
 
-    ChessPiece *piece_on_target_square = board->squares[square.x][square.y + direction];
-    if (piece_on_target_square == NULL && !only_attacking)
+void legal_masks_init(LegalMasks *self, const ChessBoard *board, ChessColor color)
+{
+    Vec2i king_pos = color == WHITE ? board->white_king_pos : board->black_king_pos;
+    int king_square = square_from_vec(king_pos);
+    Bitboard occupancy = chess_board_occupancy(board);
+    Bitboard enemies = board->colors[!color];
+
+    self->king_square = king_square;
+    self->checkers = chess_board_attackers(board, king_square, occupancy, !color);
+    self->pinned = 0;
+
+    // enemy sliders that would see the king through our own pieces pin the only piece in between
+    Bitboard queens = board->pieces[PIECE_QUEEN];
+    Bitboard snipers = (attacks_bishop(king_square, enemies) & (board->pieces[PIECE_BISHOP] | queens)) |
+                       (attacks_rook(king_square, enemies) & (board->pieces[PIECE_ROOK] | queens));
+    snipers &= enemies;
+
+    while (snipers)
     {
-        moves[n_moves++] =
-            (ChessMove){square, {square.x, square.y + direction}, is_on_promotion_rank ? PROMOTION : NORMAL};
-
-        // double push
-        if (is_on_starting_rank && board->squares[square.x][square.y + 2 * direction] == NULL)
+        Bitboard blockers = attacks_between(king_square, bb_pop_lsb(&snipers)) & occupancy;
+        if (bb_popcount(blockers) == 1)
         {
-            moves[n_moves++] = (ChessMove){square, {square.x, square.y + 2 * direction}};
+            self->pinned |= blockers & board->colors[color];
         }
     }
 
-    // diagonal captures
-    for (int i = -1; i <= 1; i += 2)
+    // a single check is answered by capturing the checker or blocking its ray, a double check by the king only
+    if (self->checkers == 0)
     {
-        int x = square.x + i;
-        int y = square.y + direction;
-
-        if (x >= 0 && x < 8 && y >= 0 && y < 8)
-        {
-            ChessPiece *piece_on_diagonal_square = board->squares[x][y];
-
-            // if attacking moves are requested, return diagonal moves irrespective of the piece on the square
-            if (only_attacking ||
-                (piece_on_diagonal_square != NULL && piece_on_diagonal_square->color != piece->color))
-            {
-                moves[n_moves++] = (ChessMove){square,
-                                               {x, y},
-                                               is_on_promotion_rank ? PROMOTION : NORMAL,
-                                               true,
-                                               only_attacking ? 0 : piece_on_diagonal_square->type};
-            }
-        }
+        self->check_mask = ~0ULL;
     }
-
-    // en passant
-    if (board->last_move != NULL)
+    else if (bb_popcount(self->checkers) == 1)
     {
-        Vec2i last_move_to = board->last_move->to;
-        bool is_on_en_passant_rank = is_white ? square.y == 4 : square.y == 3;
-
-        if (is_on_en_passant_rank)
-        {
-            bool last_move_was_pawn = board->squares[last_move_to.x][last_move_to.y]->type == PIECE_PAWN;
-            bool last_move_was_double_push = abs(last_move_to.y - board->last_move->from.y) == 2;
-            bool last_move_was_adjacent = abs(last_move_to.x - square.x) == 1;
-
-            if (last_move_was_pawn && last_move_was_double_push && last_move_was_adjacent)
-            {
-                int x = last_move_to.x;
-                int y = last_move_to.y + (is_white ? 1 : -1);
-                moves[n_moves++] = (ChessMove){square, {x, y}, EN_PASSANT, true, PIECE_PAWN};
-            }
-        }
+        self->check_mask = self->checkers | attacks_between(king_square, bb_lsb(self->checkers));
+    }
+    else
+    {
+        self->check_mask = 0;
     }
-
-    return (MoveList){moves, n_moves};
 }
 
-MoveList generate_knight_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board)
+void generate_legal_moves_masked(const ChessPiece *piece, Vec2i square, const ChessBoard *board,
+                                 const LegalMasks *masks, MoveList *out)
 {
-    ChessMove *moves = malloc(MAX_KNIGHT_MOVES * sizeof(ChessMove));
+    int from = square_from_vec(square);
+    bool is_king = piece->type == PIECE_KING;
 
-    int n_moves = 0;
-    int directions[8][2] = {{-1, 2}, {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}};
-
-    for (int i = 0; i < 8; i++)
+    if (!is_king && masks->check_mask == 0)
     {
-        int x = square.x + directions[i][0];
-        int y = square.y + directions[i][1];
-
-        if (x >= 0 && x < 8 && y >= 0 && y < 8)
-        {
-            ChessPiece *piece_on_target_square = board->squares[x][y];
-            if (piece_on_target_square == NULL || piece_on_target_square->color != piece->color)
-            {
-                bool is_capture = piece_on_target_square != NULL;
-                moves[n_moves++] = (ChessMove){
-                    square, {x, y}, NORMAL, is_capture, is_capture ? piece_on_target_square->type : 0};
-            }
-        }
+        return; // double check
     }
 
-    return (MoveList){moves, n_moves};
-}
-
-MoveList generate_bishop_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board)
-{
-    ChessMove *moves = malloc(MAX_BISHOP_MOVES * sizeof(ChessMove));
+    // generate pseudo legal moves straight into out, then compact the legal ones in place
+    int first_move = out->n_moves;
+    generate_pseudo_legal_moves(piece, square, board, out);
 
-    int n_moves = 0;
-    int directions[4][2] = {{1, 1}, {1, -1}, {-1, -1}, {-1, 1}};
+    // the king must not step onto an attacked square, looking through its own square so it cannot hide
+    // behind itself on the checking ray
+    Bitboard king_occupancy = chess_board_occupancy(board) ^ SQUARE_BB(from);
+    Bitboard pin_mask = masks->pinned & SQUARE_BB(from) ? attacks_line(masks->king_square, from) : ~0ULL;
+    int n_legal_moves = first_move;
 
-    for (int i = 0; i < 4; i++)
+    for (int i = first_move; i < out->n_moves; i++)
     {
-        int x = square.x + directions[i][0];
-        int y = square.y + directions[i][1];
+        ChessMove move = out->moves[i];
+        int to = move_to(move);
+        bool is_legal;
+
+        if (is_king)
+        {
+            is_legal = chess_board_attackers(board, to, king_occupancy, !piece->color) == 0;
+        }
+        else if (move_flags(move) == MOVE_EN_PASSANT)
+        {
+            is_legal = is_en_passant_legal(board, from, masks->king_square, piece->color);
+        }
+        else
+        {
+            is_legal = SQUARE_BB(to) & masks->check_mask & pin_mask;
+        }
 
-        while (x >= 0 && x < 8 && y >= 0 && y < 8)
+        if (is_legal)
         {
-            ChessPiece *piece_on_target_square = board->squares[x][y];
-            if (piece_on_target_square == NULL || piece_on_target_square->color != piece->color)
-            {
-                bool is_capture = piece_on_target_square != NULL;
-                moves[n_moves++] = (ChessMove){
-                    square, {x, y}, NORMAL, is_capture, is_capture ? piece_on_target_square->type : 0};
-            }
-
-            if (piece_on_target_square)
-            {
-                break;
-            }
-
-            x += directions[i][0];
-            y += directions[i][1];
+            out->moves[n_legal_moves++] = move;
         }
     }
 
-    return (MoveList){moves, n_moves};
+    out->n_moves = n_legal_moves;
 }
 
-MoveList generate_rook_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board)
+void generate_pawn_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out)
 {
-    ChessMove *moves = malloc(MAX_ROOK_MOVES * sizeof(ChessMove));
-
-    int n_moves = 0;
-    int directions[4][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}};
-
-    bool is_queen_side_rook = square.x == 0 && (square.y == 0 || square.y == 7);
-    bool is_king_side_rook = square.x == 7 && (square.y == 0 || square.y == 7);
-
-    // check what rights are removed if the rook moves
-    CastlingRightsRemoved castling_rights_removed = CASTLING_RIGHT_NONE;
-    bool king_side_allowed = piece->color == WHITE ? board->castling_rights.white_king_side
-                                                   : board->castling_rights.black_king_side;
-    bool queen_side_allowed = piece->color == WHITE ? board->castling_rights.white_queen_side
-                                                    : board->castling_rights.black_queen_side;
-
-    if (is_queen_side_rook && queen_side_allowed)
+    if (piece->color == WHITE)
     {
-        castling_rights_removed = CASTLING_RIGHT_QUEENSIDE;
+        generate_pawn_moves_white(square_from_vec(square), board, out);
     }
-    else if (is_king_side_rook && king_side_allowed)
+    else
     {
-        castling_rights_removed = CASTLING_RIGHT_KINGSIDE;
+        generate_pawn_moves_black(square_from_vec(square), board, out);
     }
+}
 
-    for (int i = 0; i < 4; i++)
-    {
-        int x = square.x + directions[i][0];
-        int y = square.y + directions[i][1];
+void generate_knight_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out)
+{
+    int from = square_from_vec(square);
+    Bitboard targets = attacks_knight(from) & ~board->colors[piece->color];
+    add_target_moves(out, from, targets, board);
+}
 
-        while (x >= 0 && x < 8 && y >= 0 && y < 8)
-        {
-            ChessPiece *piece_on_target_square = board->squares[x][y];
-            if (piece_on_target_square == NULL || piece_on_target_square->color != piece->color)
-            {
-                bool is_capture = piece_on_target_square != NULL;
-                moves[n_moves++] = (ChessMove){square,
-                                               {x, y},
-                                               NORMAL,
-                                               is_capture,
-                                               is_capture ? piece_on_target_square->type : 0,
-                                               castling_rights_removed};
-            }
-
-            if (piece_on_target_square)
-            {
-                break;
-            }
-
-            x += directions[i][0];
-            y += directions[i][1];
-        }
-    }
+void generate_bishop_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out)
+{
+    int from = square_from_vec(square);
+    Bitboard targets = attacks_bishop(from, chess_board_occupancy(board)) & ~board->colors[piece->color];
+    add_target_moves(out, from, targets, board);
+}
 
-    return (MoveList){moves, n_moves};
+void generate_rook_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out)
+{
+    int from = square_from_vec(square);
+    Bitboard targets = attacks_rook(from, chess_board_occupancy(board)) & ~board->colors[piece->color];
+    add_target_moves(out, from, targets, board);
 }
 
-MoveList generate_queen_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board)
+void generate_queen_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out)
 {
-    ChessMove *moves = malloc(MAX_QUEEN_MOVES * sizeof(ChessMove));
+    int from = square_from_vec(square);
+    Bitboard targets = attacks_queen(from, chess_board_occupancy(board)) & ~board->colors[piece->color];
+    add_target_moves(out, from, targets, board);
+}
 
-    int n_moves = 0;
-    int directions[8][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}, {1, 1}, {1, -1}, {-1, -1}, {-1, 1}};
+void generate_king_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out)
+{
+    int from = square_from_vec(square);
+    Bitboard targets = attacks_king(from) & ~board->colors[piece->color];
+    add_target_moves(out, from, targets, board);
 
-    for (int i = 0; i < 8; i++)
+    if (!chess_board_is_square_attacked(board, square, piece->color))
     {
-        int x = square.x + directions[i][0];
-        int y = square.y + directions[i][1];
-
-        while (x >= 0 && x < 8 && y >= 0 && y < 8)
+        if (piece->color == WHITE)
         {
-            ChessPiece *piece_on_target_square = board->squares[x][y];
-            if (piece_on_target_square == NULL || piece_on_target_square->color != piece->color)
-            {
-                bool is_capture = piece_on_target_square != NULL;
-                moves[n_moves++] = (ChessMove){
-                    square, {x, y}, NORMAL, is_capture, is_capture ? piece_on_target_square->type : 0};
-            }
-
-            if (piece_on_target_square)
-            {
-                break;
-            }
-
-            x += directions[i][0];
-            y += directions[i][1];
+            add_castling_moves_white(board, out);
+        }
+        else
+        {
+            add_castling_moves_black(board, out);
         }
     }
-
-    return (MoveList){moves, n_moves};
 }
 
-MoveList generate_king_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board,
-                             bool only_attacking)
+// appends a move from square to every square in targets, which must not hold friendly pieces
+static void add_target_moves(MoveList *out, int from, Bitboard targets, const ChessBoard *board)
 {
-    ChessMove *moves = malloc(MAX_KING_MOVES * sizeof(ChessMove));
-
-    int n_moves = 0;
-    int directions[8][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}, {1, 1}, {1, -1}, {-1, -1}, {-1, 1}};
-
-    CastlingRightsRemoved castling_rights_removed = CASTLING_RIGHT_NONE;
-    bool king_side_allowed = piece->color == WHITE ? board->castling_rights.white_king_side
-                                                   : board->castling_rights.black_king_side;
-    bool queen_side_allowed = piece->color == WHITE ? board->castling_rights.white_queen_side
-                                                    : board->castling_rights.black_queen_side;
-
-    if (king_side_allowed && queen_side_allowed)
-    {
-        castling_rights_removed = CASTLING_RIGHT_BOTH;
-    }
-    else if (queen_side_allowed)
-    {
-        castling_rights_removed = CASTLING_RIGHT_QUEENSIDE;
-    }
-    else if (king_side_allowed)
+    while (targets)
     {
-        castling_rights_removed = CASTLING_RIGHT_KINGSIDE;
-    }
+        int to = bb_pop_lsb(&targets);
+        bool is_capture = board->mailbox[to] != PIECE_CODE_NONE;
 
-    for (int i = 0; i < 8; i++)
-    {
-        int x = square.x + directions[i][0];
-        int y = square.y + directions[i][1];
-
-        if (x >= 0 && x < 8 && y >= 0 && y < 8)
-        {
-            ChessPiece *piece_on_target_square = board->squares[x][y];
-            if (piece_on_target_square == NULL || piece_on_target_square->color != piece->color)
-            {
-                bool is_capture = piece_on_target_square != NULL;
-                moves[n_moves++] = (ChessMove){square,
-                                               {x, y},
-                                               NORMAL,
-                                               is_capture,
-                                               is_capture ? piece_on_target_square->type : 0,
-                                               castling_rights_removed};
-            }
-        }
+        out->moves[out->n_moves++] = move_new(from, to, is_capture ? MOVE_CAPTURE : MOVE_QUIET);
     }
+}
 
-    // castling
-    if (!only_attacking)
+// appends one move per promotion piece, flags is MOVE_PROMOTION or MOVE_PROMOTION_CAPTURE
+static void add_promotions(MoveList *out, int from, int to, int flags)
+{
+    for (int i = 0; i < 4; i++)
     {
-
-        bool is_check = chess_board_is_square_attacked(board, square, piece->color);
-        bool king_side_allowed = piece->color == WHITE ? board->castling_rights.white_king_side
-                                                       : board->castling_rights.black_king_side;
-        bool queen_side_allowed = piece->color == WHITE ? board->castling_rights.white_queen_side
-                                                        : board->castling_rights.black_queen_side;
-
-        // king side
-        if (!is_check && king_side_allowed)
-        {
-            bool is_castling_legal = true;
-
-            Vec2i squares_to_check[] = {{5, square.y}, {6, square.y}};
-            for (int i = 0; i < 2; i++)
-            {
-                if (board->squares[squares_to_check[i].x][squares_to_check[i].y] != NULL)
-                {
-                    // square is occupied
-                    is_castling_legal = false;
-                    break;
-                }
-                if (chess_board_is_square_attacked(board, squares_to_check[i], piece->color))
-                {
-                    is_castling_legal = false;
-                    break;
-                }
-            }
-            if (is_castling_legal)
-            {
-                moves[n_moves++] =
-                    (ChessMove){square, {6, square.y}, CASTLE_KINGSIDE, false, 0, castling_rights_removed};
-            }
-        }
-
-        // queen side
-        if (!is_check && queen_side_allowed)
-        {
-            bool is_castling_legal = true;
-
-            Vec2i squares_to_check[] = {{1, square.y}, {2, square.y}, {3, square.y}};
-            for (int i = 0; i < 3; i++)
-            {
-                if (board->squares[squares_to_check[i].x][squares_to_check[i].y] != NULL)
-                {
-                    // square is occupied
-                    is_castling_legal = false;
-                    break;
-                }
-                if (i != 1 && chess_board_is_square_attacked(board, squares_to_check[i], piece->color))
-                {
-                    is_castling_legal = false;
-                    break;
-                }
-            }
-            if (is_castling_legal)
-            {
-                moves[n_moves++] =
-                    (ChessMove){square, {2, square.y}, CASTLE_QUEENSIDE, false, 0, castling_rights_removed};
-            }
-        }
+        out->moves[out->n_moves++] = move_new(from, to, flags | i);
     }
-
-    return (MoveList){moves, n_moves};
-}
\ No newline at end of file
+}
@@ -3,56 +3,63 @@
 
 #include "../types.h"
 #include "board.h"
+#include "move.h"
 #include "piece.h"
 
-#define MAX_PAWN_MOVES 4
-#define MAX_KNIGHT_MOVES 8
-#define MAX_BISHOP_MOVES 13
-#define MAX_ROOK_MOVES 14
-#define MAX_QUEEN_MOVES 27
-#define MAX_KING_MOVES 8
-
-typedef enum CastlingRightsRemoved
-{
-    CASTLING_RIGHT_NONE,
-    CASTLING_RIGHT_KINGSIDE,
-    CASTLING_RIGHT_QUEENSIDE,
-    CASTLING_RIGHT_BOTH
-} CastlingRightsRemoved;
-
-typedef struct ChessMove
-{
-    Vec2i from;
-    Vec2i to;
-
-    enum MoveType
-    {
-        NORMAL,
-        CASTLE_KINGSIDE,
-        CASTLE_QUEENSIDE,
-        EN_PASSANT,
-        PROMOTION
-    } type;
-
-    bool is_capture;
-    PieceType captured_type;
-    CastlingRightsRemoved castling_rights_removed; 
-    CastlingRightsRemoved opponent_castling_rights_removed;
-} ChessMove;
+// upper bound on the number of moves in any position, every move buffer must hold this many
+#define MAX_MOVES 256
 
+// generators append to moves[n_moves..], the buffer is owned by the caller (usually on the stack)
 typedef struct
 {
     ChessMove *moves;
     int n_moves;
 } MoveList;
 
-MoveList generate_pseudo_legal_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, bool only_attacking);
-MoveList generate_legal_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board);
-MoveList generate_pawn_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, bool only_attacking);
-MoveList generate_knight_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board);
-MoveList generate_bishop_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board);
-MoveList generate_rook_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board);
-MoveList generate_queen_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board);
-MoveList generate_king_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, bool only_attacking);
+// checks and pins of one side, computed once per position and shared by the generators of all its pieces
+typedef struct
+{
+    Bitboard checkers;   // enemy pieces giving check
+    Bitboard pinned;     // own pieces that may only move along the line between the king and a pinner
+    Bitboard check_mask; // target squares that resolve the check(s) for a non king move, all squares if none
+    int king_square;
+} LegalMasks;
+
+// the kinds of legal moves generate_legal_stage produces
+typedef enum
+{
+    GENERATE_CAPTURES,   // captures, en passant and promotions that capture
+    GENERATE_PROMOTIONS, // promotions by a push
+    GENERATE_QUIETS,     // everything else, castling included
+    GENERATE_ALL,        // all three at once
+} GenerateStage;
+
+// wraps a caller owned buffer of at least MAX_MOVES moves as an empty list
+static inline MoveList move_list_from_buffer(ChessMove *buffer) { return (MoveList){buffer, 0}; }
+
+void generate_pseudo_legal_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board,
+                                 MoveList *out);
+
+// every legal move of the side to move in one pass, with the checks and pins computed once. like all the
+// generators it only reads the board, so any number of threads may generate moves for the same position:
+// legality is decided with masks and attack lookups, never by playing the move
+void generate_all_legal_moves(const ChessBoard *board, MoveList *out);
+// the number of moves generate_all_legal_moves would produce, counted from destination masks without writing
+// any moves (perft leaves, mobility)
+int count_legal_moves(const ChessBoard *board);
+// the legal moves of one kind for the side to move, so a search can leave the later kinds ungenerated
+void generate_legal_stage(const ChessBoard *board, GenerateStage stage, MoveList *out);
+void generate_legal_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out);
+void legal_masks_init(LegalMasks *self, const ChessBoard *board, ChessColor color);
+// same as generate_legal_moves, with the masks of piece->color already computed by legal_masks_init
+void generate_legal_moves_masked(const ChessPiece *piece, Vec2i square, const ChessBoard *board,
+                                 const LegalMasks *masks, MoveList *out);
+void generate_pawn_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out);
+void generate_knight_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out);
+void generate_bishop_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out);
+void generate_rook_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out);
+void generate_queen_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out);
+void generate_king_moves(const ChessPiece *piece, Vec2i square, const ChessBoard *board, MoveList *out);
+
 
 #endif
\ No newline at end of file
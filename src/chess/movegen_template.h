@@ -0,0 +1,251 @@
+// color specialized move generation, included by movegen.c once per color with COLOR defined as WHITE or
+// BLACK and COLOR_NAME(name) appending the color to a function name. everything that depends on the color
+// is a constant expression here, so the compiler folds the color tests away and the loops have no branches
+// on it. no include guard on purpose
+
+#define THEM (1 - COLOR)
+#define PUSH(bb) (COLOR == WHITE ? (bb) << 8 : (bb) >> 8)
+#define BACK_RANK (COLOR == WHITE ? 0 : 7)
+#define PROMOTION_RANK_BB (COLOR == WHITE ? RANK_8_BB : RANK_1_BB)
+#define DOUBLE_PUSH_RANK_BB (COLOR == WHITE ? RANK_1_BB << 24 : RANK_1_BB << 32)
+#define KING_SIDE_RIGHT (COLOR == WHITE ? CASTLE_WHITE_KING_SIDE : CASTLE_BLACK_KING_SIDE)
+#define QUEEN_SIDE_RIGHT (COLOR == WHITE ? CASTLE_WHITE_QUEEN_SIDE : CASTLE_BLACK_QUEEN_SIDE)
+
+// squares between king and rook that must be empty
+#define KING_SIDE_EMPTY_BB ((SQUARE_BB(5) | SQUARE_BB(6)) << (8 * BACK_RANK))
+#define QUEEN_SIDE_EMPTY_BB ((SQUARE_BB(1) | SQUARE_BB(2) | SQUARE_BB(3)) << (8 * BACK_RANK))
+
+// castling moves of a king that is not in check, legal by construction. the castling rights imply that king
+// and rook are on their starting squares
+static void COLOR_NAME(add_castling_moves)(const ChessBoard *board, MoveList *out)
+{
+    const int king = SQUARE_INDEX(4, BACK_RANK);
+    Bitboard occupancy = chess_board_occupancy(board);
+
+    if ((board->castling_rights & KING_SIDE_RIGHT) && !(occupancy & KING_SIDE_EMPTY_BB) &&
+        !chess_board_attackers(board, king + 1, occupancy, THEM) &&
+        !chess_board_attackers(board, king + 2, occupancy, THEM))
+    {
+        out->moves[out->n_moves++] = move_new(king, king + 2, MOVE_CASTLE_KINGSIDE);
+    }
+
+    // the king never crosses the b file, so it only has to be empty
+    if ((board->castling_rights & QUEEN_SIDE_RIGHT) && !(occupancy & QUEEN_SIDE_EMPTY_BB) &&
+        !chess_board_attackers(board, king - 1, occupancy, THEM) &&
+        !chess_board_attackers(board, king - 2, occupancy, THEM))
+    {
+        out->moves[out->n_moves++] = move_new(king, king - 2, MOVE_CASTLE_QUEENSIDE);
+    }
+}
+
+static void COLOR_NAME(generate_pawn_moves)(int from, const ChessBoard *board, MoveList *out)
+{
+    Bitboard attacks = attacks_pawn(from, COLOR);
+    Bitboard empty = ~chess_board_occupancy(board);
+    Bitboard single_push = PUSH(SQUARE_BB(from)) & empty;
+    Bitboard double_push = PUSH(single_push) & empty & DOUBLE_PUSH_RANK_BB;
+
+    if (single_push & PROMOTION_RANK_BB)
+    {
+        add_promotions(out, from, bb_lsb(single_push), MOVE_PROMOTION);
+    }
+    else if (single_push)
+    {
+        out->moves[out->n_moves++] = move_new(from, bb_lsb(single_push), MOVE_QUIET);
+    }
+    if (double_push)
+    {
+        out->moves[out->n_moves++] = move_new(from, bb_lsb(double_push), MOVE_DOUBLE_PUSH);
+    }
+
+    Bitboard captures = attacks & board->colors[THEM];
+    while (captures)
+    {
+        int to = bb_pop_lsb(&captures);
+        if (SQUARE_BB(to) & PROMOTION_RANK_BB)
+        {
+            add_promotions(out, from, to, MOVE_PROMOTION_CAPTURE);
+        }
+        else
+        {
+            out->moves[out->n_moves++] = move_new(from, to, MOVE_CAPTURE);
+        }
+    }
+
+    // the en passant square is only set behind an enemy pawn that just made a double push
+    if (board->en_passant_square != NO_SQUARE && (attacks & SQUARE_BB(board->en_passant_square)))
+    {
+        out->moves[out->n_moves++] = move_new(from, board->en_passant_square, MOVE_EN_PASSANT);
+    }
+}
+
+static int COLOR_NAME(count_legal_moves)(const ChessBoard *board)
+{
+    LegalMasks masks;
+    legal_masks_init(&masks, board, COLOR);
+
+    Bitboard own = board->colors[COLOR];
+    Bitboard occupancy = chess_board_occupancy(board);
+    int king = masks.king_square;
+    int n_moves = 0;
+
+    // the king looks through its own square, as in generate_legal_moves_masked
+    Bitboard danger = chess_board_attacked_squares(board, occupancy ^ SQUARE_BB(king), THEM);
+    n_moves += bb_popcount(attacks_king(king) & ~own & ~danger);
+
+    if (masks.checkers)
+    {
+        if (masks.check_mask == 0)
+        {
+            return n_moves; // double check
+        }
+    }
+    else
+    {
+        ChessMove castling_buffer[2];
+        MoveList castling = move_list_from_buffer(castling_buffer);
+        COLOR_NAME(add_castling_moves)(board, &castling);
+        n_moves += castling.n_moves;
+    }
+
+    // every other piece moves to the squares it attacks, restricted by the check mask and its pin line
+    Bitboard targets = ~own & masks.check_mask;
+    Bitboard pieces = own & ~board->pieces[PIECE_KING] & ~board->pieces[PIECE_PAWN];
+    while (pieces)
+    {
+        int from = bb_pop_lsb(&pieces);
+        Bitboard pin_mask = masks.pinned & SQUARE_BB(from) ? attacks_line(king, from) : ~0ULL;
+
+        n_moves += bb_popcount(piece_attacks(board, from, occupancy) & targets & pin_mask);
+    }
+
+    // pawns, with four moves for every promotion square
+    Bitboard empty = ~occupancy;
+    Bitboard pawns = own & board->pieces[PIECE_PAWN];
+    while (pawns)
+    {
+        int from = bb_pop_lsb(&pawns);
+        Bitboard pin_mask = masks.pinned & SQUARE_BB(from) ? attacks_line(king, from) : ~0ULL;
+        Bitboard single_push = PUSH(SQUARE_BB(from)) & empty;
+        Bitboard double_push = PUSH(single_push) & empty & DOUBLE_PUSH_RANK_BB;
+        Bitboard captures = attacks_pawn(from, COLOR) & board->colors[THEM];
+        Bitboard pawn_targets = (single_push | double_push | captures) & masks.check_mask & pin_mask;
+
+        n_moves += bb_popcount(pawn_targets) + 3 * bb_popcount(pawn_targets & PROMOTION_RANK_BB);
+
+        if (board->en_passant_square != NO_SQUARE &&
+            (attacks_pawn(from, COLOR) & SQUARE_BB(board->en_passant_square)))
+        {
+            n_moves += is_en_passant_legal(board, from, king, COLOR);
+        }
+    }
+
+    return n_moves;
+}
+
+static void COLOR_NAME(generate_legal_stage)(const ChessBoard *board, GenerateStage stage, MoveList *out)
+{
+    LegalMasks masks;
+    legal_masks_init(&masks, board, COLOR);
+
+    Bitboard own = board->colors[COLOR];
+    Bitboard enemies = board->colors[THEM];
+    Bitboard occupancy = own | enemies;
+    bool captures_wanted = stage == GENERATE_CAPTURES || stage == GENERATE_ALL;
+    bool promotions_wanted = stage == GENERATE_PROMOTIONS || stage == GENERATE_ALL;
+    bool quiets_wanted = stage == GENERATE_QUIETS || stage == GENERATE_ALL;
+    Bitboard stage_targets = (captures_wanted ? enemies : 0) | (quiets_wanted ? ~occupancy : 0);
+    int king = masks.king_square;
+
+    // king steps and castling, checked the same way as in count_legal_moves
+    Bitboard danger = chess_board_attacked_squares(board, occupancy ^ SQUARE_BB(king), THEM);
+    add_target_moves(out, king, attacks_king(king) & stage_targets & ~danger, board);
+    if (quiets_wanted && masks.checkers == 0)
+    {
+        COLOR_NAME(add_castling_moves)(board, out);
+    }
+
+    if (masks.check_mask == 0)
+    {
+        return; // double check
+    }
+
+    Bitboard targets = stage_targets & masks.check_mask;
+    Bitboard pieces = own & ~board->pieces[PIECE_KING] & ~board->pieces[PIECE_PAWN];
+    while (pieces && targets)
+    {
+        int from = bb_pop_lsb(&pieces);
+        Bitboard pin_mask = masks.pinned & SQUARE_BB(from) ? attacks_line(king, from) : ~0ULL;
+
+        add_target_moves(out, from, piece_attacks(board, from, occupancy) & targets & pin_mask, board);
+    }
+
+    Bitboard empty = ~occupancy;
+    Bitboard pawns = own & board->pieces[PIECE_PAWN];
+    while (pawns)
+    {
+        int from = bb_pop_lsb(&pawns);
+        Bitboard legal_mask = masks.check_mask;
+        if (masks.pinned & SQUARE_BB(from))
+        {
+            legal_mask &= attacks_line(king, from);
+        }
+
+        if (captures_wanted)
+        {
+            Bitboard captures = attacks_pawn(from, COLOR) & enemies & legal_mask;
+            while (captures)
+            {
+                int to = bb_pop_lsb(&captures);
+                if (SQUARE_BB(to) & PROMOTION_RANK_BB)
+                {
+                    add_promotions(out, from, to, MOVE_PROMOTION_CAPTURE);
+                }
+                else
+                {
+                    out->moves[out->n_moves++] = move_new(from, to, MOVE_CAPTURE);
+                }
+            }
+
+            if (board->en_passant_square != NO_SQUARE &&
+                (attacks_pawn(from, COLOR) & SQUARE_BB(board->en_passant_square)) &&
+                is_en_passant_legal(board, from, king, COLOR))
+            {
+                out->moves[out->n_moves++] = move_new(from, board->en_passant_square, MOVE_EN_PASSANT);
+            }
+        }
+
+        Bitboard single_push = PUSH(SQUARE_BB(from)) & empty;
+        Bitboard double_push = PUSH(single_push) & empty & DOUBLE_PUSH_RANK_BB & legal_mask;
+        single_push &= legal_mask;
+
+        if (single_push & PROMOTION_RANK_BB)
+        {
+            if (promotions_wanted)
+            {
+                add_promotions(out, from, bb_lsb(single_push), MOVE_PROMOTION);
+            }
+        }
+        else if (quiets_wanted)
+        {
+            if (single_push)
+            {
+                out->moves[out->n_moves++] = move_new(from, bb_lsb(single_push), MOVE_QUIET);
+            }
+            if (double_push)
+            {
+                out->moves[out->n_moves++] = move_new(from, bb_lsb(double_push), MOVE_DOUBLE_PUSH);
+            }
+        }
+    }
+}
+
+#undef THEM
+#undef PUSH
+#undef BACK_RANK
+#undef PROMOTION_RANK_BB
+#undef DOUBLE_PUSH_RANK_BB
+#undef KING_SIDE_RIGHT
+#undef QUEEN_SIDE_RIGHT
+#undef KING_SIDE_EMPTY_BB
+#undef QUEEN_SIDE_EMPTY_BB
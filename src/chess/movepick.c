@@ -0,0 +1,272 @@
+#include <stddef.h>
+
+#include "movepick.h"
+
+// victim and attacker values for ordering captures, a king never loses material by capturing
+static const int piece_values[N_PIECE_TYPES] = {100, 320, 330, 500, 0, 900};
+
+// an exchange losing less than this, such as a bishop for a knight, still counts as an even trade
+#define BAD_CAPTURE_MARGIN 50
+
+static bool is_legal(const ChessBoard *board, ChessMove move);
+static bool is_hint(const MovePicker *self, ChessMove move);
+static void score_captures(MovePicker *self);
+static int static_exchange(const ChessBoard *board, ChessMove move);
+
+void move_picker_init(MovePicker *self, const ChessBoard *board, ChessMove hash_move,
+                      const ChessMove killers[2])
+{
+    self->board = board;
+    self->hash_move = hash_move;
+    self->killers[0] = killers != NULL ? killers[0] : MOVE_NONE;
+    self->killers[1] = killers != NULL ? killers[1] : MOVE_NONE;
+    self->stage = PICK_HASH_MOVE;
+    self->next = 0;
+    self->n_moves = 0;
+    self->bad_capture = MAX_MOVES;
+    self->killer = 0;
+}
+
+ChessMove move_picker_next(MovePicker *self)
+{
+    MoveList list;
+    bool is_promotions;
+
+    for (;;)
+    {
+        switch (self->stage)
+        {
+        case PICK_HASH_MOVE:
+            self->stage = PICK_GENERATE_CAPTURES;
+            if (is_legal(self->board, self->hash_move))
+            {
+                return self->hash_move;
+            }
+            self->hash_move = MOVE_NONE;
+            break;
+
+        case PICK_GENERATE_CAPTURES:
+            list = move_list_from_buffer(self->moves);
+            generate_legal_stage(self->board, GENERATE_CAPTURES, &list);
+            self->n_moves = list.n_moves;
+            self->next = 0;
+            score_captures(self);
+            self->stage = PICK_GOOD_CAPTURES;
+            break;
+
+        case PICK_GOOD_CAPTURES:
+            while (self->next < self->n_moves)
+            {
+                // selection sort one step at a time, the rest stays unsorted if a cutoff comes first
+                int best = self->next;
+                for (int i = self->next + 1; i < self->n_moves; i++)
+                {
+                    best = self->scores[i] > self->scores[best] ? i : best;
+                }
+
+                ChessMove move = self->moves[best];
+                int score = self->scores[best];
+                self->moves[best] = self->moves[self->next];
+                self->scores[best] = self->scores[self->next];
+                self->next++;
+
+                if (move == self->hash_move)
+                {
+                    continue;
+                }
+                if (score < 0)
+                {
+                    self->moves[--self->bad_capture] = move;
+                    continue;
+                }
+                return move;
+            }
+            self->stage = PICK_GENERATE_PROMOTIONS;
+            break;
+
+        case PICK_GENERATE_PROMOTIONS:
+        case PICK_GENERATE_QUIETS:
+            // the moves of the finished stages are used up, so the new ones can overwrite them
+            is_promotions = self->stage == PICK_GENERATE_PROMOTIONS;
+            list = move_list_from_buffer(self->moves);
+            generate_legal_stage(self->board, is_promotions ? GENERATE_PROMOTIONS : GENERATE_QUIETS, &list);
+            self->n_moves = list.n_moves;
+            self->next = 0;
+            self->stage = is_promotions ? PICK_PROMOTIONS : PICK_QUIETS;
+            break;
+
+        case PICK_PROMOTIONS:
+            while (self->next < self->n_moves)
+            {
+                ChessMove move = self->moves[self->next++];
+                if (move != self->hash_move)
+                {
+                    return move;
+                }
+            }
+            self->stage = PICK_KILLERS;
+            break;
+
+        case PICK_KILLERS:
+            while (self->killer < 2)
+            {
+                int i = self->killer++;
+                ChessMove move = self->killers[i];
+                bool is_quiet = !move_is_capture(move) && !move_is_promotion(move);
+                bool is_repeat = i == 1 && move == self->killers[0];
+
+                if (is_quiet && !is_repeat && move != self->hash_move && is_legal(self->board, move))
+                {
+                    return move;
+                }
+                // the quiet stage skips the killers, so only the ones handed out may stay
+                self->killers[i] = is_repeat ? move : MOVE_NONE;
+            }
+            self->stage = PICK_GENERATE_QUIETS;
+            break;
+
+        case PICK_QUIETS:
+            while (self->next < self->n_moves)
+            {
+                ChessMove move = self->moves[self->next++];
+                if (!is_hint(self, move))
+                {
+                    return move;
+                }
+            }
+            self->next = self->bad_capture;
+            self->stage = PICK_BAD_CAPTURES;
+            break;
+
+        case PICK_BAD_CAPTURES:
+            if (self->next < MAX_MOVES)
+            {
+                return self->moves[self->next++];
+            }
+            self->stage = PICK_DONE;
+            break;
+
+        case PICK_DONE: return MOVE_NONE;
+        }
+    }
+}
+
+// legality of a move from outside the generators, by generating the moves of the piece it moves
+static bool is_legal(const ChessBoard *board, ChessMove move)
+{
+    if (move == MOVE_NONE)
+    {
+        return false;
+    }
+
+    uint8_t code = board->mailbox[move_from(move)];
+    if (code == PIECE_CODE_NONE || PIECE_CODE_COLOR(code) != board->turn)
+    {
+        return false;
+    }
+
+    ChessPiece piece = {PIECE_CODE_TYPE(code), PIECE_CODE_COLOR(code)};
+    ChessMove buffer[MAX_MOVES];
+    MoveList moves = move_list_from_buffer(buffer);
+    generate_legal_moves(&piece, square_to_vec(move_from(move)), board, &moves);
+
+    for (int i = 0; i < moves.n_moves; i++)
+    {
+        if (moves.moves[i] == move)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// moves already handed out by the hash move and killer stages
+static bool is_hint(const MovePicker *self, ChessMove move)
+{
+    return move == self->hash_move || move == self->killers[0] || move == self->killers[1];
+}
+
+// most valuable victim first, then least valuable attacker. a capture of a cheaper piece than the attacker
+// is only sure to win material if the exchange on the square says so, one losing more than the margin scores
+// below zero and waits until after the quiet moves
+static void score_captures(MovePicker *self)
+{
+    const ChessBoard *board = self->board;
+
+    for (int i = 0; i < self->n_moves; i++)
+    {
+        ChessMove move = self->moves[i];
+        uint8_t victim = board->mailbox[move_to(move)];
+        // en passant is the only capture onto an empty square
+        int victim_value = piece_values[victim != PIECE_CODE_NONE ? PIECE_CODE_TYPE(victim) : PIECE_PAWN];
+        int attacker_value = piece_values[PIECE_CODE_TYPE(board->mailbox[move_from(move)])];
+
+        if (move_is_promotion(move))
+        {
+            victim_value += piece_values[move_promotion_type(move)] - piece_values[PIECE_PAWN];
+        }
+
+        bool is_bad = victim_value < attacker_value && static_exchange(board, move) < -BAD_CAPTURE_MARGIN;
+        self->scores[i] = is_bad ? -1 : victim_value * 10 - attacker_value / 10;
+    }
+}
+
+// material won by a capture once both sides have recaptured on its square with their least valuable piece
+// for as long as it pays. pins are ignored. only called for captures by a knight or a bigger piece, so
+// never for en passant or promotions
+static int static_exchange(const ChessBoard *board, ChessMove move)
+{
+    static const PieceType cheapest_first[N_PIECE_TYPES] = {PIECE_PAWN,  PIECE_KNIGHT, PIECE_BISHOP,
+                                                            PIECE_ROOK,  PIECE_QUEEN,  PIECE_KING};
+    int to = move_to(move);
+    Bitboard occupancy = chess_board_occupancy(board) ^ SQUARE_BB(move_from(move));
+    ChessColor side = !board->turn;
+
+    // gains[i] is what the side making capture i wins if the exchange stopped right after it
+    int gains[32];
+    int n_captures = 1;
+    gains[0] = piece_values[PIECE_CODE_TYPE(board->mailbox[to])];
+    PieceType on_square = PIECE_CODE_TYPE(board->mailbox[move_from(move)]);
+
+    for (;;)
+    {
+        Bitboard attackers = chess_board_attackers(board, to, occupancy, side);
+        if (attackers == 0)
+        {
+            break;
+        }
+
+        PieceType type = PIECE_KING;
+        Bitboard candidates = attackers & board->pieces[PIECE_KING];
+        for (int i = 0; i < N_PIECE_TYPES; i++)
+        {
+            if (attackers & board->pieces[cheapest_first[i]])
+            {
+                type = cheapest_first[i];
+                candidates = attackers & board->pieces[type];
+                break;
+            }
+        }
+
+        // the king can't take if the square is still covered, and taking a king ends the exchange anyway
+        if (on_square == PIECE_KING ||
+            (type == PIECE_KING && chess_board_attackers(board, to, occupancy, !side) != 0))
+        {
+            break;
+        }
+
+        gains[n_captures] = piece_values[on_square] - gains[n_captures - 1];
+        n_captures++;
+        occupancy ^= SQUARE_BB(bb_lsb(candidates));
+        on_square = type;
+        side = !side;
+    }
+
+    // each side only makes its capture when it does better than stopping
+    while (--n_captures > 0)
+    {
+        int stop = -gains[n_captures - 1];
+        gains[n_captures - 1] = -(stop > gains[n_captures] ? stop : gains[n_captures]);
+    }
+    return gains[0];
+}
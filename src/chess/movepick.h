@@ -0,0 +1,46 @@
+#if !defined(MOVEPICK_H)
+#define MOVEPICK_H
+
+#include "board.h"
+#include "move.h"
+#include "movegen.h"
+
+typedef enum
+{
+    PICK_HASH_MOVE,
+    PICK_GENERATE_CAPTURES,
+    PICK_GOOD_CAPTURES,
+    PICK_GENERATE_PROMOTIONS,
+    PICK_PROMOTIONS,
+    PICK_KILLERS,
+    PICK_GENERATE_QUIETS,
+    PICK_QUIETS,
+    PICK_BAD_CAPTURES,
+    PICK_DONE,
+} PickStage;
+
+// hands out the legal moves of a position one at a time in search order: the hash move, captures that don't
+// lose material in the exchange (most valuable victim first), promotions, killers, quiet moves and the losing
+// captures. each kind is only generated once the ones before it ran out, so a cutoff on an early move never
+// pays for generating the quiet moves
+typedef struct
+{
+    const ChessBoard *board;
+    ChessMove hash_move;
+    ChessMove killers[2];
+    PickStage stage;
+    int next;
+    int n_moves;     // moves of the current stage in moves[0, n_moves)
+    int bad_capture; // captures that lose material wait in moves[bad_capture, MAX_MOVES)
+    int killer;
+    ChessMove moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+} MovePicker;
+
+// hash_move and killers are hints that may be illegal or MOVE_NONE, killers may be NULL
+void move_picker_init(MovePicker *self, const ChessBoard *board, ChessMove hash_move,
+                      const ChessMove killers[2]);
+// the next move, MOVE_NONE once every legal move was handed out
+ChessMove move_picker_next(MovePicker *self);
+
+#endif
@@ -0,0 +1,285 @@
+#include <string.h>
+
+#include "movegen.h"
+#include "notation.h"
+
+static const char piece_letters[N_PIECE_TYPES] = {'P', 'N', 'B', 'R', 'K', 'Q'};
+
+static char *write_square(char *out, int square);
+static int parse_square(const char *text);
+static PieceType piece_type_from_letter(char letter, bool *found);
+
+void move_to_uci(ChessMove move, char *out)
+{
+    out = write_square(out, move_from(move));
+    out = write_square(out, move_to(move));
+    if (move_is_promotion(move))
+    {
+        *out++ = piece_letters[move_promotion_type(move)] | 0x20;
+    }
+    *out = '\0';
+}
+
+void move_to_san(const ChessBoard *board, ChessMove move, char *out)
+{
+    ChessMove buffer[MAX_MOVES];
+    MoveList moves = move_list_from_buffer(buffer);
+    int from = move_from(move), to = move_to(move);
+    PieceType type = PIECE_CODE_TYPE(board->mailbox[from]);
+
+    if (move_is_castle(move))
+    {
+        strcpy(out, move_flags(move) == MOVE_CASTLE_KINGSIDE ? "O-O" : "O-O-O");
+        out += strlen(out);
+    }
+    else
+    {
+        if (type == PIECE_PAWN)
+        {
+            if (move_is_capture(move))
+            {
+                *out++ = 'a' + SQUARE_FILE(from);
+            }
+        }
+        else
+        {
+            *out++ = piece_letters[type];
+
+            // name the from file if it tells the pieces of this type that can reach to apart, else the rank,
+            // else both
+            bool ambiguous = false, same_file = false, same_rank = false;
+            generate_all_legal_moves(board, &moves);
+            for (int i = 0; i < moves.n_moves; i++)
+            {
+                int other = move_from(moves.moves[i]);
+                bool same_piece = other != from && board->mailbox[other] == board->mailbox[from];
+                if (same_piece && move_to(moves.moves[i]) == to)
+                {
+                    ambiguous = true;
+                    same_file |= SQUARE_FILE(other) == SQUARE_FILE(from);
+                    same_rank |= SQUARE_RANK(other) == SQUARE_RANK(from);
+                }
+            }
+
+            if (ambiguous && (!same_file || same_rank))
+            {
+                *out++ = 'a' + SQUARE_FILE(from);
+            }
+            if (ambiguous && same_file)
+            {
+                *out++ = '1' + SQUARE_RANK(from);
+            }
+        }
+
+        if (move_is_capture(move))
+        {
+            *out++ = 'x';
+        }
+        out = write_square(out, to);
+
+        if (move_is_promotion(move))
+        {
+            *out++ = '=';
+            *out++ = piece_letters[move_promotion_type(move)];
+        }
+    }
+
+    ChessBoard after;
+    chess_board_copy_make_move(&after, board, move);
+    if (chess_board_is_in_check(&after, after.turn))
+    {
+        moves.n_moves = 0;
+        generate_all_legal_moves(&after, &moves);
+        *out++ = moves.n_moves > 0 ? '+' : '#';
+    }
+    *out = '\0';
+}
+
+ChessMove move_from_uci(const ChessBoard *board, const char *text)
+{
+    size_t length = strlen(text);
+    if (length != 4 && length != 5)
+    {
+        return MOVE_NONE;
+    }
+
+    int from = parse_square(text), to = parse_square(text + 2);
+    bool is_promotion = length == 5, found;
+    PieceType promotion_type = piece_type_from_letter(text[4] & ~0x20, &found);
+
+    if (from < 0 || to < 0 || (is_promotion && !found))
+    {
+        return MOVE_NONE;
+    }
+
+    ChessMove buffer[MAX_MOVES];
+    MoveList moves = move_list_from_buffer(buffer);
+    generate_all_legal_moves(board, &moves);
+
+    for (int i = 0; i < moves.n_moves; i++)
+    {
+        ChessMove move = moves.moves[i];
+        if (move_from(move) == from && move_to(move) == to && move_is_promotion(move) == is_promotion &&
+            (!is_promotion || move_promotion_type(move) == promotion_type))
+        {
+            return move;
+        }
+    }
+
+    return MOVE_NONE;
+}
+
+ChessMove move_from_san(const ChessBoard *board, const char *text)
+{
+    size_t length = strlen(text);
+
+    // strip check, mate and annotation marks and the optional en passant suffix
+    while (length > 0 && strchr("+#!?", text[length - 1]) != NULL)
+    {
+        length--;
+    }
+    if (length >= 4 && strncmp(text + length - 4, "e.p.", 4) == 0)
+    {
+        length -= 4;
+        while (length > 0 && text[length - 1] == ' ')
+        {
+            length--;
+        }
+    }
+
+    // what the text pins down, -1 where it leaves the choice open
+    PieceType type = PIECE_PAWN;
+    int castle_flags = -1, from_file = -1, from_rank = -1, to = -1;
+    bool is_promotion = false, found;
+    PieceType promotion_type = PIECE_QUEEN;
+
+    if (length == 3 && (strncmp(text, "O-O", 3) == 0 || strncmp(text, "0-0", 3) == 0))
+    {
+        castle_flags = MOVE_CASTLE_KINGSIDE;
+    }
+    else if (length == 5 && (strncmp(text, "O-O-O", 5) == 0 || strncmp(text, "0-0-0", 5) == 0))
+    {
+        castle_flags = MOVE_CASTLE_QUEENSIDE;
+    }
+    else
+    {
+        const char *c = text, *end = text + length;
+
+        // a trailing piece letter, with or without the '=', is a promotion
+        if (length > 2)
+        {
+            promotion_type = piece_type_from_letter(end[-1], &found);
+            if (found)
+            {
+                is_promotion = true;
+                end -= end[-2] == '=' ? 2 : 1;
+            }
+        }
+
+        PieceType piece_type = piece_type_from_letter(*c, &found);
+        if (found)
+        {
+            type = piece_type;
+            c++;
+        }
+
+        // the target square is last, what comes before it is at most a from file, a from rank and an 'x'
+        if (end - c < 2 || (to = parse_square(end - 2)) < 0)
+        {
+            return MOVE_NONE;
+        }
+        end -= 2;
+        if (end > c && end[-1] == 'x')
+        {
+            end--;
+        }
+        if (c < end && *c >= 'a' && *c <= 'h')
+        {
+            from_file = *c++ - 'a';
+        }
+        if (c < end && *c >= '1' && *c <= '8')
+        {
+            from_rank = *c++ - '1';
+        }
+        // pawns promote exactly when they reach the last rank, and only to knight, bishop, rook or queen
+        bool last_rank = SQUARE_RANK(to) == 0 || SQUARE_RANK(to) == 7;
+        if (c != end || (type == PIECE_PAWN && is_promotion != last_rank))
+        {
+            return MOVE_NONE;
+        }
+        if (is_promotion &&
+            (type != PIECE_PAWN || promotion_type == PIECE_PAWN || promotion_type == PIECE_KING))
+        {
+            return MOVE_NONE;
+        }
+    }
+
+    ChessMove buffer[MAX_MOVES];
+    MoveList moves = move_list_from_buffer(buffer);
+    ChessMove match = MOVE_NONE;
+    generate_all_legal_moves(board, &moves);
+
+    for (int i = 0; i < moves.n_moves; i++)
+    {
+        ChessMove move = moves.moves[i];
+        int from = move_from(move);
+
+        bool matches;
+        if (castle_flags >= 0)
+        {
+            matches = move_flags(move) == castle_flags;
+        }
+        else
+        {
+            matches = move_to(move) == to && !move_is_castle(move) &&
+                      PIECE_CODE_TYPE(board->mailbox[from]) == type &&
+                      (from_file < 0 || SQUARE_FILE(from) == from_file) &&
+                      (from_rank < 0 || SQUARE_RANK(from) == from_rank) &&
+                      (!is_promotion || move_promotion_type(move) == promotion_type);
+        }
+
+        if (matches)
+        {
+            if (match != MOVE_NONE)
+            {
+                return MOVE_NONE; // ambiguous
+            }
+            match = move;
+        }
+    }
+
+    return match;
+}
+
+static char *write_square(char *out, int square)
+{
+    *out++ = 'a' + SQUARE_FILE(square);
+    *out++ = '1' + SQUARE_RANK(square);
+    return out;
+}
+
+// square index of a coordinate such as "e4", -1 if it is not one
+static int parse_square(const char *text)
+{
+    if (text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8')
+    {
+        return -1;
+    }
+    return SQUARE_INDEX(text[0] - 'a', text[1] - '1');
+}
+
+// the piece of an uppercase SAN letter, found is false for anything else
+static PieceType piece_type_from_letter(char letter, bool *found)
+{
+    for (int type = 0; type < N_PIECE_TYPES; type++)
+    {
+        if (piece_letters[type] == letter)
+        {
+            *found = true;
+            return type;
+        }
+    }
+
+    *found = false;
+    return PIECE_PAWN;
+}
@@ -0,0 +1,23 @@
+#if !defined(NOTATION_H)
+#define NOTATION_H
+
+#include "board.h"
+#include "move.h"
+
+// buffer size that holds any move written by move_to_uci or move_to_san, terminator included
+#define MOVE_STRING_LENGTH 10
+
+// long algebraic as used by UCI engines: "e2e4", "e7e8q", castling as the king's move "e1g1"
+void move_to_uci(ChessMove move, char *out);
+// standard algebraic of a legal move of the side to move: "Nbd7", "exd6", "e8=Q", "O-O", with a '+' or
+// '#' suffix for moves that give check or mate
+void move_to_san(const ChessBoard *board, ChessMove move, char *out);
+
+// the decoders generate the legal moves once and pick the one the text describes, MOVE_NONE if the text is
+// malformed or no legal move, or more than one, matches it
+ChessMove move_from_uci(const ChessBoard *board, const char *text);
+// accepts the usual variations: "0-0" for castling, "e8Q" without the '=', an "e.p." suffix and check,
+// mate and annotation suffixes ("+", "#", "!?")
+ChessMove move_from_san(const ChessBoard *board, const char *text);
+
+#endif
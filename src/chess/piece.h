@@ -1,6 +1,8 @@
 #if !defined(CHESS_PIECE_H)
 #define CHESS_PIECE_H
 
+#include <stdint.h>
+
 typedef enum
 {
     PIECE_PAWN,
@@ -11,6 +13,8 @@ typedef enum
     PIECE_QUEEN,
 } PieceType;
 
+#define N_PIECE_TYPES 6
+
 typedef enum
 {
     BLACK = 0,
@@ -23,7 +27,10 @@ typedef struct
     ChessColor color;
 } ChessPiece;
 
-ChessPiece *chess_piece_new(PieceType type, ChessColor color);
-void chess_piece_delete(ChessPiece *self);
+// compact one byte piece encoding used by the board mailbox, 0 means an empty square
+#define PIECE_CODE_NONE 0
+#define PIECE_CODE(type, color) ((uint8_t)(((color) << 3) | ((type) + 1)))
+#define PIECE_CODE_TYPE(code) ((PieceType)(((code) & 7) - 1))
+#define PIECE_CODE_COLOR(code) ((ChessColor)((code) >> 3))
 
 #endif
\ No newline at end of file
@@ -15,11 +15,14 @@
 #define PIECE_ANIMATION_DURATION 0.13
 
 static void empty_move_list(ChessGame *game);
+static void select_piece_moves(ChessGame *game, int square);
 static void check_chess_state(ChessGame *game);
 static Vec2i calc_board_relative_pos(Vec2i board_top_left, Vec2i board_size, Vec2i square,
                                      ChessColor plr_color);
 static void handle_promotion_menu(ChessGame *game, bool left_btn_pressed);
 static void handle_board_interaction(ChessGame *game, bool left_btn_pressed);
+static void handle_history_keys(ChessGame *game);
+static bool is_same_square(Vec2i a, Vec2i b);
 static void update_piece_animations(ChessGame *game, double delta_time);
 static void on_resign_btn_clicked(UIComponent *c, void *data);
 
@@ -50,7 +53,7 @@ void gameplay_state_setup(ChessGame *game)
     ui_data->board_pos = (Vec2i){36, center.y + ui_data->board_size.y / 2};
     ui_data->mouse_down = false;
     ui_data->mouse_pos = (Vec2f){0, 0};
-    ui_data->selected_piece = NULL;
+    ui_data->history_key_down = false;
     ui_data->selected_square = (Vec2i){-1, -1};
     ui_data->promotion_menu_open = false;
     ui_data->promotion_menu_size = (Vec2i){335, 90};
@@ -60,14 +63,15 @@ void gameplay_state_setup(ChessGame *game)
 
     for (int i = 0; i < MAX_PIECE_ANIMATIONS; i++)
     {
-        ui_data->piece_animations[i].animating_piece = NULL;
+        ui_data->piece_animations[i].is_animating = false;
         ui_data->piece_animations[i].animation_time = 0;
     }
 
     chess_board_init(&chess_data->board);
+    chess_history_init(&chess_data->history, CHESS_HISTORY_DEFAULT_CAPACITY);
     chess_data->current_turn = WHITE;
     chess_data->player_color = WHITE;
-    chess_data->current_move_list = (MoveList){NULL, 0};
+    chess_data->current_move_list = move_list_from_buffer(chess_data->move_buffer);
     chess_data->is_in_check = false;
 
     Color4i text_color = {255, 255, 255, 255};
@@ -117,6 +121,11 @@ void gameplay_state_update(ChessGame *game, double delta_time)
     Vec2i board_size = ui_data->board_size;
     Vec2f square_size = {(float)board_size.x / 8, (float)board_size.y / 8};
 
+    if (!ui_data->promotion_menu_open)
+    {
+        handle_history_keys(game);
+    }
+
     if (!chess_data->is_game_over)
     {
         // promotion menu
@@ -137,7 +146,6 @@ void gameplay_state_update(ChessGame *game, double delta_time)
                 // user clicked outside board
                 ui_data->mouse_down = true;
                 ui_data->selected_square = (Vec2i){-1, -1};
-                ui_data->selected_piece = NULL;
                 empty_move_list(game);
             }
             else if (ui_data->mouse_down && !left_btn_pressed)
@@ -180,7 +188,7 @@ void gameplay_state_render(ChessGame *game)
                            (Vec2i){ceil(square_size.x), ceil(square_size.y)});
     }
 
-    ChessPiece *selected_piece = ui_data->selected_piece;
+    bool has_selection = ui_data->selected_square.x != -1;
 
     // check indicator
     if (chess_data->is_in_check)
@@ -194,15 +202,16 @@ void gameplay_state_render(ChessGame *game)
     }
 
     // selected piece moves
-    if (selected_piece && chess_data->current_move_list.n_moves > 0)
+    if (has_selection && chess_data->current_move_list.n_moves > 0)
     {
         for (int i = 0; i < chess_data->current_move_list.n_moves; i++)
         {
             ChessMove move = chess_data->current_move_list.moves[i];
-            bool is_capture = chess_data->board.squares[move.to.x][move.to.y] != NULL;
-            bool is_en_passant = move.type == EN_PASSANT;
+            Vec2i to = square_to_vec(move_to(move));
+            bool is_capture = !chess_board_is_empty(&chess_data->board, to);
+            bool is_en_passant = move_flags(move) == MOVE_EN_PASSANT;
 
-            Vec2i square_pos = calc_board_relative_pos(board_pos, board_size, move.to, plr_color);
+            Vec2i square_pos = calc_board_relative_pos(board_pos, board_size, to, plr_color);
             Vec2i circle_size = (Vec2i){ceil(square_size.x * 0.3), ceil(square_size.y * 0.3)};
             Vec2i circle_pos = (Vec2i){square_pos.x + square_size.x / 2 - circle_size.x / 2,
                                        square_pos.y - square_size.y / 2 + circle_size.y / 2};
@@ -226,24 +235,28 @@ void gameplay_state_render(ChessGame *game)
     {
         for (int j = 0; j < 8; j++)
         {
-            ChessPiece *piece = chess_data->board.squares[i][j];
+            Vec2i square = {i, j};
 
+            // pieces being animated are drawn on their way to the square they already stand on
             bool is_currently_animating = false;
             for (int k = 0; k < MAX_PIECE_ANIMATIONS; k++)
             {
-                if (piece == ui_data->piece_animations[k].animating_piece)
+                if (ui_data->piece_animations[k].is_animating &&
+                    is_same_square(ui_data->piece_animations[k].animating_to, square))
                 {
                     is_currently_animating = true;
                     break;
                 }
             }
 
-            if (piece != NULL)
+            if (!chess_board_is_empty(&chess_data->board, square))
             {
-                if ((ui_data->mouse_down && piece == ui_data->selected_piece) || is_currently_animating)
+                bool is_dragged = ui_data->mouse_down && is_same_square(ui_data->selected_square, square);
+                if (is_dragged || is_currently_animating)
                     continue;
 
-                Texture tex = game->piece_textures[piece->type + (piece->color == BLACK ? 6 : 0)];
+                ChessPiece piece = chess_board_piece_at(&chess_data->board, square);
+                Texture tex = game->piece_textures[piece.type + (piece.color == BLACK ? 6 : 0)];
                 Vec2i piece_pos = calc_board_relative_pos(board_pos, board_size, (Vec2i){i, j}, plr_color);
 
                 renderer_draw_rect_tex(r, tex, piece_pos, (Vec2i){square_size.x, square_size.y});
@@ -254,7 +267,7 @@ void gameplay_state_render(ChessGame *game)
     // currently moving piece
     for (int i = 0; i < MAX_PIECE_ANIMATIONS; i++)
     {
-        if (ui_data->piece_animations[i].animating_piece)
+        if (ui_data->piece_animations[i].is_animating)
         {
             Vec2i from = calc_board_relative_pos(board_pos, board_size,
                                                  ui_data->piece_animations[i].animating_from, plr_color);
@@ -266,18 +279,18 @@ void gameplay_state_render(ChessGame *game)
                                       from.y + (to.y - from.y) * ui_data->piece_animations[i].animation_time /
                                                    PIECE_ANIMATION_DURATION};
 
-            Texture tex =
-                game->piece_textures[ui_data->piece_animations[i].animating_piece->type +
-                                     (ui_data->piece_animations[i].animating_piece->color == BLACK ? 6 : 0)];
+            ChessPiece piece = ui_data->piece_animations[i].animating_piece;
+            Texture tex = game->piece_textures[piece.type + (piece.color == BLACK ? 6 : 0)];
 
             renderer_draw_rect_tex(r, tex, piece_pos, (Vec2i){square_size.x, square_size.y});
         }
     }
 
     // dragged piece
-    if (ui_data->mouse_down && selected_piece)
+    if (ui_data->mouse_down && has_selection)
     {
-        Texture tex = game->piece_textures[selected_piece->type + (selected_piece->color == BLACK ? 6 : 0)];
+        ChessPiece selected_piece = ui_data->selected_piece;
+        Texture tex = game->piece_textures[selected_piece.type + (selected_piece.color == BLACK ? 6 : 0)];
         Vec2i piece_pos =
             (Vec2i){ui_data->mouse_pos.x - square_size.x / 2, ui_data->mouse_pos.y + square_size.y / 2};
 
@@ -305,7 +318,8 @@ void gameplay_state_render(ChessGame *game)
     if (chess_data->is_game_over)
     {
         GameEndReason end_reason = chess_data->game_end_reason;
-        bool is_draw = end_reason == STALEMATE;
+        bool is_draw = end_reason == STALEMATE || end_reason == REPETITION || end_reason == FIFTY_MOVE ||
+                       end_reason == INSUFFICIENT_MATERIAL;
         bool is_resignation = end_reason == RESIGNATION;
         bool is_plr_winner =
             !is_draw && !is_resignation && chess_data->player_color != chess_data->current_turn;
@@ -315,8 +329,12 @@ void gameplay_state_render(ChessGame *game)
                                  center.y + ui_data->promotion_menu_size.y / 2};
         renderer_draw_rect_tex(r, game->menu_bg_texture, menu_pos, menu_size);
 
-        char *reason_text =
-            end_reason == CHECKMATE ? "Checkmate" : (end_reason == RESIGNATION ? "Resignation" : "Stalemate");
+        char *reason_text = end_reason == CHECKMATE               ? "Checkmate"
+                            : end_reason == RESIGNATION           ? "Resignation"
+                            : end_reason == REPETITION            ? "Repetition"
+                            : end_reason == FIFTY_MOVE            ? "Fifty moves"
+                            : end_reason == INSUFFICIENT_MATERIAL ? "No mating material"
+                                                                  : "Stalemate";
         char *end_text = is_plr_winner ? "  You win!  " : (is_draw ? "Draw" : "Game over");
 
         Color4i text_color = {255, 255, 255, 255};
@@ -329,7 +347,11 @@ void gameplay_state_render(ChessGame *game)
     }
 };
 
-void gameplay_state_cleanup(ChessGame *game) { ui_destroy_all(game->ui); };
+void gameplay_state_cleanup(ChessGame *game)
+{
+    chess_history_destroy(&game->chess_data.history);
+    ui_destroy_all(game->ui);
+};
 
 static Vec2i calc_board_relative_pos(Vec2i board_top_left, Vec2i board_size, Vec2i square,
                                      ChessColor plr_color)
@@ -338,11 +360,30 @@ static Vec2i calc_board_relative_pos(Vec2i board_top_left, Vec2i board_size, Vec
                    board_top_left.y - (plr_color == WHITE ? (7 - square.y) : square.y) * board_size.y / 8};
 }
 
+static bool is_same_square(Vec2i a, Vec2i b) { return a.x == b.x && a.y == b.y; }
+
 static void empty_move_list(ChessGame *game)
+{
+    game->chess_data.current_move_list.n_moves = 0;
+}
+
+// fills the current move list with the legal moves starting on square
+static void select_piece_moves(ChessGame *game, int square)
 {
     struct ChessData *chess_data = &game->chess_data;
-    free(chess_data->current_move_list.moves);
-    chess_data->current_move_list = (MoveList){NULL, 0};
+
+    ChessMove buffer[MAX_MOVES];
+    MoveList all_moves = move_list_from_buffer(buffer);
+    generate_all_legal_moves(&chess_data->board, &all_moves);
+
+    chess_data->current_move_list = move_list_from_buffer(chess_data->move_buffer);
+    for (int i = 0; i < all_moves.n_moves; i++)
+    {
+        if (move_from(all_moves.moves[i]) == square)
+        {
+            chess_data->current_move_list.moves[chess_data->current_move_list.n_moves++] = all_moves.moves[i];
+        }
+    }
 }
 
 static void check_chess_state(ChessGame *game)
@@ -378,6 +419,28 @@ static void check_chess_state(ChessGame *game)
             chess_data->game_end_reason = STALEMATE;
         }
     }
+
+    if (chess_data->is_game_over)
+        return;
+
+    if (chess_history_is_repetition(&chess_data->history, &chess_data->board))
+    {
+        printf("Draw by repetition\n");
+        chess_data->is_game_over = true;
+        chess_data->game_end_reason = REPETITION;
+    }
+    else if (chess_board_is_fifty_move_draw(&chess_data->board))
+    {
+        printf("Draw by the fifty-move rule\n");
+        chess_data->is_game_over = true;
+        chess_data->game_end_reason = FIFTY_MOVE;
+    }
+    else if (chess_board_is_insufficient_material(&chess_data->board))
+    {
+        printf("Draw by insufficient material\n");
+        chess_data->is_game_over = true;
+        chess_data->game_end_reason = INSUFFICIENT_MATERIAL;
+    }
 }
 
 static void handle_promotion_menu(ChessGame *game, bool left_btn_pressed)
@@ -402,17 +465,24 @@ static void handle_promotion_menu(ChessGame *game, bool left_btn_pressed)
         PieceType promoted_type = promoted_types[x];
 
         ChessMove *move = ui_data->pending_promotion_move;
-        chess_board_promote_pawn(&chess_data->board, ui_data->pawn_to_promote, move, promoted_type);
+        if (!chess_history_make_move(&chess_data->history, &chess_data->board,
+                                     move_with_promotion(*move, promoted_type)))
+        {
+            return;
+        }
         chess_data->current_turn = chess_data->current_turn == WHITE ? BLACK : WHITE;
         check_chess_state(game);
 
         empty_move_list(game);
         ui_data->promotion_menu_open = false;
-        ui_data->pawn_to_promote = NULL;
 
-        ui_data->piece_animations[0].animating_piece = ui_data->selected_piece;
+        // the promoted piece slides in from the pawn's square, if the pawn was dragged there
+        Vec2i promotion_square = square_to_vec(move_to(*move));
+        ui_data->piece_animations[0].is_animating = ui_data->selected_square.x != -1;
+        ui_data->piece_animations[0].animating_piece =
+            chess_board_piece_at(&chess_data->board, promotion_square);
         ui_data->piece_animations[0].animating_from = ui_data->selected_square;
-        ui_data->piece_animations[0].animating_to = move->to;
+        ui_data->piece_animations[0].animating_to = promotion_square;
         ui_data->piece_animations[0].animation_time = 0;
     }
     else if (ui_data->mouse_down && !left_btn_pressed)
@@ -449,41 +519,45 @@ static void handle_board_interaction(ChessGame *game, bool left_btn_pressed)
 
         bool move_made = false;
 
-        if (ui_data->selected_piece)
+        if (ui_data->selected_square.x != -1)
         {
             for (int i = 0; i < chess_data->current_move_list.n_moves; i++)
             {
                 ChessMove *move = &chess_data->current_move_list.moves[i];
-                if (move->to.x == x && move->to.y == y)
+                if (move_to(*move) == SQUARE_INDEX(x, y))
                 {
-                    if (move->type == PROMOTION)
+                    if (move_is_promotion(*move))
                     {
                         ui_data->promotion_menu_open = true;
                         ui_data->pending_promotion_move = move;
-                        ui_data->pawn_to_promote = ui_data->selected_piece;
                     }
                     else
                     {
-                        chess_board_make_move(&chess_data->board, ui_data->selected_piece, move);
+                        if (!chess_history_make_move(&chess_data->history, &chess_data->board, *move))
+                        {
+                            return;
+                        }
                         chess_data->current_turn = chess_data->current_turn == WHITE ? BLACK : WHITE;
                         check_chess_state(game);
 
                         // animate piece
+                        ui_data->piece_animations[0].is_animating = true;
                         ui_data->piece_animations[0].animating_piece = ui_data->selected_piece;
                         ui_data->piece_animations[0].animating_from = ui_data->selected_square;
-                        ui_data->piece_animations[0].animating_to = move->to;
+                        ui_data->piece_animations[0].animating_to = square_to_vec(move_to(*move));
                         ui_data->piece_animations[0].animation_time = 0;
 
-                        if (move->type == CASTLE_KINGSIDE || move->type == CASTLE_QUEENSIDE)
+                        if (move_is_castle(*move))
                         {
-                            Vec2i rook_from = move->type == CASTLE_KINGSIDE ? (Vec2i){7, move->to.y}
-                                                                            : (Vec2i){0, move->to.y};
-                            Vec2i rook_to = move->type == CASTLE_KINGSIDE ? (Vec2i){5, move->to.y}
-                                                                          : (Vec2i){3, move->to.y};
-                            ChessPiece *rook = chess_data->board.squares[rook_to.x][rook_to.y];
+                            bool is_king_side = move_flags(*move) == MOVE_CASTLE_KINGSIDE;
+                            int rank = SQUARE_RANK(move_to(*move));
+                            Vec2i rook_from = is_king_side ? (Vec2i){7, rank} : (Vec2i){0, rank};
+                            Vec2i rook_to = is_king_side ? (Vec2i){5, rank} : (Vec2i){3, rank};
 
                             // animate rook as well if castling
-                            ui_data->piece_animations[1].animating_piece = rook;
+                            ui_data->piece_animations[1].is_animating = true;
+                            ui_data->piece_animations[1].animating_piece =
+                                chess_board_piece_at(&chess_data->board, rook_to);
                             ui_data->piece_animations[1].animating_from = rook_from;
                             ui_data->piece_animations[1].animating_to = rook_to;
                             ui_data->piece_animations[1].animation_time = 0;
@@ -498,16 +572,14 @@ static void handle_board_interaction(ChessGame *game, bool left_btn_pressed)
             }
         }
         ui_data->selected_square = (Vec2i){-1, -1};
-        ui_data->selected_piece = NULL;
 
-        if (!move_made && chess_data->board.squares[x][y] &&
-            chess_data->board.squares[x][y]->color == chess_data->current_turn)
+        if (!move_made && !chess_board_is_empty(&chess_data->board, (Vec2i){x, y}) &&
+            chess_board_piece_at(&chess_data->board, (Vec2i){x, y}).color == chess_data->current_turn)
         {
             // clicked on a piece
             ui_data->selected_square = (Vec2i){x, y};
-            ui_data->selected_piece = chess_data->board.squares[x][y];
-            chess_data->current_move_list =
-                generate_legal_moves(ui_data->selected_piece, (Vec2i){x, y}, &chess_data->board);
+            ui_data->selected_piece = chess_board_piece_at(&chess_data->board, (Vec2i){x, y});
+            select_piece_moves(game, SQUARE_INDEX(x, y));
         }
     }
     else if (ui_data->mouse_down && !left_btn_pressed)
@@ -515,29 +587,30 @@ static void handle_board_interaction(ChessGame *game, bool left_btn_pressed)
         // clicked and released
         ui_data->mouse_down = false;
 
-        if (ui_data->selected_piece)
+        if (ui_data->selected_square.x != -1)
         {
             // move piece
             for (int i = 0; i < chess_data->current_move_list.n_moves; i++)
             {
                 ChessMove *move = &chess_data->current_move_list.moves[i];
-                if (move->to.x == x && move->to.y == y)
+                if (move_to(*move) == SQUARE_INDEX(x, y))
                 {
-                    if (move->type == PROMOTION)
+                    if (move_is_promotion(*move))
                     {
                         ui_data->promotion_menu_open = true;
                         ui_data->pending_promotion_move = move;
-                        ui_data->pawn_to_promote = ui_data->selected_piece;
                     }
                     else
                     {
-                        chess_board_make_move(&chess_data->board, ui_data->selected_piece, move);
+                        if (!chess_history_make_move(&chess_data->history, &chess_data->board, *move))
+                        {
+                            return;
+                        }
                         chess_data->current_turn = chess_data->current_turn == WHITE ? BLACK : WHITE;
                         check_chess_state(game);
 
                         empty_move_list(game);
                         ui_data->selected_square = (Vec2i){-1, -1};
-                        ui_data->selected_piece = NULL;
                     }
 
                     break;
@@ -547,19 +620,64 @@ static void handle_board_interaction(ChessGame *game, bool left_btn_pressed)
     }
 }
 
+// left arrow takes back the last move, right arrow plays it again. a resignation ends the game for good,
+// unlike the results the position decides, which a takeback re-checks
+static void handle_history_keys(ChessGame *game)
+{
+    struct ChessData *chess_data = &game->chess_data;
+    struct UIData *ui_data = &game->ui_data;
+    GLFWwindow *glfw_window = game->renderer->window->glfw_window;
+
+    if (chess_data->is_game_over && chess_data->game_end_reason == RESIGNATION)
+    {
+        return;
+    }
+
+    bool undo_pressed = glfwGetKey(glfw_window, GLFW_KEY_LEFT) == GLFW_PRESS;
+    bool redo_pressed = glfwGetKey(glfw_window, GLFW_KEY_RIGHT) == GLFW_PRESS;
+
+    if (ui_data->history_key_down)
+    {
+        ui_data->history_key_down = undo_pressed || redo_pressed;
+        return;
+    }
+    ui_data->history_key_down = undo_pressed || redo_pressed;
+
+    bool changed = (undo_pressed && chess_history_undo(&chess_data->history, &chess_data->board)) ||
+                   (redo_pressed && chess_history_redo(&chess_data->history, &chess_data->board));
+    if (!changed)
+    {
+        return;
+    }
+
+    // the pieces jump to the new position, drop anything that refers to the old one
+    for (int i = 0; i < MAX_PIECE_ANIMATIONS; i++)
+    {
+        ui_data->piece_animations[i].is_animating = false;
+        ui_data->piece_animations[i].animation_time = 0;
+    }
+    ui_data->selected_square = (Vec2i){-1, -1};
+    empty_move_list(game);
+
+    chess_data->current_turn = chess_data->board.turn;
+    chess_data->is_in_check = false;
+    chess_data->is_game_over = false;
+    check_chess_state(game);
+}
+
 static void update_piece_animations(ChessGame *game, double delta_time)
 {
     struct UIData *ui_data = &game->ui_data;
 
     for (int i = 0; i < MAX_PIECE_ANIMATIONS; i++)
     {
-        if (ui_data->piece_animations[i].animating_piece)
+        if (ui_data->piece_animations[i].is_animating)
         {
             ui_data->piece_animations[i].animation_time += delta_time;
 
             if (ui_data->piece_animations[i].animation_time >= PIECE_ANIMATION_DURATION)
             {
-                ui_data->piece_animations[i].animating_piece = NULL;
+                ui_data->piece_animations[i].is_animating = false;
                 ui_data->piece_animations[i].animation_time = 0;
             }
         }
@@ -0,0 +1,65 @@
+#include "zobrist.h"
+
+uint64_t zobrist_pieces[16][64];
+uint64_t zobrist_castling[16];
+uint64_t zobrist_en_passant[8];
+uint64_t zobrist_black_to_move;
+
+static uint64_t random_u64(uint64_t *state);
+
+// fixed seed, so hashes are the same on every run
+void zobrist_init(void)
+{
+    uint64_t seed = 0x6A09E667F3BCC909ULL;
+
+    for (int code = 0; code < 16; code++)
+    {
+        for (int square = 0; square < 64; square++)
+        {
+            zobrist_pieces[code][square] = random_u64(&seed);
+        }
+    }
+    for (int i = 0; i < 16; i++)
+    {
+        zobrist_castling[i] = random_u64(&seed);
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        zobrist_en_passant[i] = random_u64(&seed);
+    }
+    zobrist_black_to_move = random_u64(&seed);
+}
+
+uint64_t zobrist_hash(const ChessBoard *board)
+{
+    uint64_t hash = 0;
+
+    Bitboard occupied = chess_board_occupancy(board);
+    while (occupied)
+    {
+        int square = bb_pop_lsb(&occupied);
+        hash ^= zobrist_pieces[board->mailbox[square]][square];
+    }
+
+    hash ^= zobrist_castling_key(board->castling_rights);
+
+    if (board->en_passant_square != NO_SQUARE)
+    {
+        hash ^= zobrist_en_passant[SQUARE_FILE(board->en_passant_square)];
+    }
+    if (board->turn == BLACK)
+    {
+        hash ^= zobrist_black_to_move;
+    }
+
+    return hash;
+}
+
+// xorshift64*
+static uint64_t random_u64(uint64_t *state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
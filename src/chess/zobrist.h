@@ -0,0 +1,22 @@
+#if !defined(ZOBRIST_H)
+#define ZOBRIST_H
+
+#include <stdint.h>
+
+#include "board.h"
+
+// random keys xor-ed together into a 64 bit position hash
+extern uint64_t zobrist_pieces[16][64]; // indexed by PIECE_CODE and square
+extern uint64_t zobrist_castling[16];   // indexed by CastlingRights
+extern uint64_t zobrist_en_passant[8];  // indexed by the file of the en passant square
+extern uint64_t zobrist_black_to_move;
+
+// fills the keys, must be called once at startup before any hashing
+void zobrist_init(void);
+
+static inline uint64_t zobrist_castling_key(CastlingRights rights) { return zobrist_castling[rights]; }
+
+// computes the hash of a position from scratch, ChessBoard.hash keeps the same value up to date incrementally
+uint64_t zobrist_hash(const ChessBoard *board);
+
+#endif
@@ -1,9 +1,14 @@
+#include "chess/attacks.h"
+#include "chess/zobrist.h"
 #include "chess/game.h"
 #include "gfx/window.h"
 #include "gfx/renderer.h"
 
 int main()
-{   
+{
+    attacks_init();
+    zobrist_init();
+
     Window w;
     window_init(&w, 840, 800, "Chess");
 
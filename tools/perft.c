@@ -0,0 +1,1208 @@
+// Headless perft harness for the chess core: counts the leaf nodes of the legal move tree to a fixed depth
+// and compares them with the published counts of the standard test positions.
+//
+// usage:
+//   perft [options]                      run every reference position to its default depth
+//   perft [options] suite <depth>        run every reference position to at most <depth>
+//   perft [options] run <depth> [fen]    count nodes of one position (start position by default)
+//   perft [options] divide <depth> [fen] print the node count below every root move
+//   perft [options] epd <depth> <file>   check the D1 to D<depth> counts of every position in an EPD file,
+//                                        depth 0 only times parsing it
+//   perft check                          run the regression checks of the rules perft counts can't see
+//
+// options:
+//   -t <threads>  hand the root moves out to a pool of workers, each on its own board copy, and report the
+//                 speedup over the same split timed on one thread first
+//   -h <mb>       cache subtree node counts in a hash table of the given size shared by all workers
+//   -c 1          copy the board for every move (copy-make) instead of making and taking it back
+//   -p 1          walk the moves in the staged order of the move picker, with sibling moves as the hash
+//                 move and killers, to check that it hands out every legal move exactly once
+//   -f <bits>     only use the CpuFeature bits given, -f 0 runs the portable attack kernels
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chess/attacks.h"
+#include "chess/board.h"
+#include "chess/cpu.h"
+#include "chess/epd.h"
+#include "chess/history.h"
+#include "chess/movegen.h"
+#include "chess/movepick.h"
+#include "chess/notation.h"
+#include "chess/zobrist.h"
+
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define MAX_REFERENCE_DEPTH 7
+#define MAX_THREADS 64
+#define MAX_HASH_MB 65536
+#define MAX_PERFT_DEPTH 64
+
+typedef struct
+{
+    const char *name;
+    const char *fen;
+    int default_depth;
+    unsigned long long nodes[MAX_REFERENCE_DEPTH]; // nodes[d - 1] is the count at depth d, 0 if unknown
+} ReferencePosition;
+
+// https://www.chessprogramming.org/Perft_Results
+static const ReferencePosition reference_positions[] = {
+    {"start", START_FEN, 6, {20ULL, 400ULL, 8902ULL, 197281ULL, 4865609ULL, 119060324ULL, 3195901860ULL}},
+    {"kiwipete",
+     "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+     5,
+     {48ULL, 2039ULL, 97862ULL, 4085603ULL, 193690690ULL, 8031647685ULL}},
+    {"position 3",
+     "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+     6,
+     {14ULL, 191ULL, 2812ULL, 43238ULL, 674624ULL, 11030083ULL, 178633661ULL}},
+    {"position 4",
+     "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+     5,
+     {6ULL, 264ULL, 9467ULL, 422333ULL, 15833292ULL, 706045033ULL}},
+    {"position 5",
+     "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+     5,
+     {44ULL, 1486ULL, 62379ULL, 2103487ULL, 89941194ULL}},
+    {"position 6",
+     "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     5,
+     {46ULL, 2079ULL, 89890ULL, 3894594ULL, 164075551ULL, 6923051137ULL}},
+};
+
+#define N_REFERENCE_POSITIONS (int)(sizeof(reference_positions) / sizeof(reference_positions[0]))
+
+static double wall_time(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// cpu time used by the calling thread, unlike wall time it does not grow while the thread waits for a core
+static double thread_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// root moves shared by the workers, each one takes the next unsearched move until none are left
+typedef struct
+{
+    const ChessBoard *root;
+    const MoveList *moves;
+    unsigned long long *move_nodes; // nodes below every root move, filled in by whichever worker searched it
+    int depth;
+    int next_move;
+    pthread_mutex_t lock;
+} RootSplit;
+
+typedef struct
+{
+    RootSplit *split;
+    pthread_t thread;
+    unsigned long long nodes;
+    unsigned long long hash_probes;
+    unsigned long long hash_hits;
+    int n_moves;
+    double cpu_time;
+    ChessMove hints[MAX_PERFT_DEPTH][3]; // killers and hash move for the move picker, per remaining depth
+} PerftWorker;
+
+typedef struct
+{
+    unsigned long long nodes;
+    unsigned long long hash_probes;
+    unsigned long long hash_hits;
+    double wall_time;
+    double cpu_time;           // summed over the workers
+    double single_thread_time; // wall time of the same split on one thread, only measured for several
+    int n_threads;
+    PerftWorker workers[MAX_THREADS];
+} PerftStats;
+
+// subtree node counts shared by all workers without locking. data packs the count above the depth, and key
+// holds the position hash xor-ed with data, so an entry torn by two threads writing at once fails the key
+// check and reads as a miss instead of a wrong count
+typedef struct
+{
+    uint64_t key;
+    uint64_t data;
+} PerftEntry;
+
+static PerftEntry *perft_table;
+static uint64_t perft_table_mask;
+
+static bool use_copy_make;
+static bool use_move_picker;
+
+// a power of two number of entries fitting in size_mb, returns false if the allocation failed
+static bool perft_table_init(int size_mb)
+{
+    uint64_t n_entries = 1;
+    while (n_entries * 2 * sizeof(PerftEntry) <= (uint64_t)size_mb << 20)
+    {
+        n_entries *= 2;
+    }
+
+    perft_table = calloc(n_entries, sizeof(PerftEntry));
+    perft_table_mask = n_entries - 1;
+    return perft_table != NULL;
+}
+
+static void perft_table_clear(void)
+{
+    if (perft_table != NULL)
+    {
+        memset(perft_table, 0, (perft_table_mask + 1) * sizeof(PerftEntry));
+    }
+}
+
+static bool perft_table_probe(uint64_t hash, int depth, unsigned long long *nodes)
+{
+    PerftEntry *entry = &perft_table[hash & perft_table_mask];
+    uint64_t key = entry->key;
+    uint64_t data = entry->data;
+
+    if ((key ^ data) != hash || (int)(data & 0xFF) != depth)
+    {
+        return false;
+    }
+
+    *nodes = data >> 8;
+    return true;
+}
+
+static void perft_table_store(uint64_t hash, int depth, unsigned long long nodes)
+{
+    PerftEntry *entry = &perft_table[hash & perft_table_mask];
+    uint64_t data = (uint64_t)nodes << 8 | depth;
+
+    entry->key = hash ^ data;
+    entry->data = data;
+}
+
+static unsigned long long perft(ChessBoard *board, int depth, PerftWorker *worker);
+
+// nodes below move, played on a copy of board or made and taken back on board itself
+static unsigned long long perft_child(ChessBoard *board, ChessMove move, int depth, PerftWorker *worker)
+{
+    unsigned long long nodes;
+
+    if (use_copy_make)
+    {
+        ChessBoard child;
+        chess_board_copy_make_move(&child, board, move);
+        nodes = perft(&child, depth - 1, worker);
+    }
+    else
+    {
+        MoveUndo undo;
+        chess_board_make_move(board, move, &undo);
+        nodes = perft(board, depth - 1, worker);
+        chess_board_undo_move(board, &undo);
+    }
+
+    return nodes;
+}
+
+static unsigned long long perft(ChessBoard *board, int depth, PerftWorker *worker)
+{
+    // bulk counting: the leaves are the legal moves themselves, no need to generate or play them. the move
+    // picker check walks to depth 0 so the picker runs at the leaves too
+    if (depth == 0)
+    {
+        return 1;
+    }
+    if (depth == 1 && !use_move_picker)
+    {
+        return count_legal_moves(board);
+    }
+
+    uint64_t hash = 0;
+    unsigned long long nodes = 0;
+
+    if (perft_table != NULL)
+    {
+        hash = board->hash;
+        worker->hash_probes++;
+
+        if (perft_table_probe(hash, depth, &nodes))
+        {
+            worker->hash_hits++;
+            return nodes;
+        }
+    }
+
+    if (use_move_picker)
+    {
+        // the last quiet moves and the first move searched at this depth in a sibling stand in for the
+        // killers and the hash move a search would supply
+        ChessMove *hints = worker->hints[depth];
+        MovePicker picker;
+        ChessMove move;
+
+        move_picker_init(&picker, board, hints[2], hints);
+        for (int i = 0; (move = move_picker_next(&picker)) != MOVE_NONE; i++)
+        {
+            nodes += perft_child(board, move, depth, worker);
+
+            if (i == 0)
+            {
+                hints[2] = move;
+            }
+            if (!move_is_capture(move) && !move_is_promotion(move) && move != hints[0])
+            {
+                hints[1] = hints[0];
+                hints[0] = move;
+            }
+        }
+    }
+    else
+    {
+        ChessMove buffer[MAX_MOVES];
+        MoveList moves = move_list_from_buffer(buffer);
+        generate_all_legal_moves(board, &moves);
+
+        for (int i = 0; i < moves.n_moves; i++)
+        {
+            nodes += perft_child(board, moves.moves[i], depth, worker);
+        }
+    }
+
+    if (perft_table != NULL)
+    {
+        perft_table_store(hash, depth, nodes);
+    }
+
+    return nodes;
+}
+
+static void *perft_worker(void *arg)
+{
+    PerftWorker *worker = arg;
+    RootSplit *split = worker->split;
+    double start = thread_time();
+
+    // the search makes and takes back moves on its board, so every worker needs its own
+    ChessBoard board = *split->root;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&split->lock);
+        int i = split->next_move++;
+        pthread_mutex_unlock(&split->lock);
+
+        if (i >= split->moves->n_moves)
+        {
+            break;
+        }
+
+        MoveUndo undo;
+        chess_board_make_move(&board, split->moves->moves[i], &undo);
+        split->move_nodes[i] = perft(&board, split->depth - 1, worker);
+        chess_board_undo_move(&board, &undo);
+
+        worker->nodes += split->move_nodes[i];
+        worker->n_moves++;
+    }
+
+    worker->cpu_time = thread_time() - start;
+    return NULL;
+}
+
+// hands the root moves of split out to n_threads workers and returns the wall time until all are searched
+static double run_workers(RootSplit *split, PerftWorker *workers, int n_threads)
+{
+    split->next_move = 0;
+    double start = wall_time();
+
+    for (int i = 0; i < n_threads; i++)
+    {
+        workers[i].split = split;
+        pthread_create(&workers[i].thread, NULL, perft_worker, &workers[i]);
+    }
+    for (int i = 0; i < n_threads; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    return wall_time() - start;
+}
+
+// searches the given root moves on n_threads workers, depth must be at least 1. with several threads the
+// same split is timed on one thread first, so the speedup is measured rather than inferred from cpu time.
+// the hash table is cleared before each pass, so neither one starts warm
+static void perft_split(const ChessBoard *board, const MoveList *moves, int depth, int n_threads,
+                        unsigned long long *move_nodes, PerftStats *stats)
+{
+    RootSplit split = {board, moves, move_nodes, depth, 0};
+    pthread_mutex_init(&split.lock, NULL);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->n_threads = n_threads;
+
+    if (n_threads > 1)
+    {
+        static PerftWorker baseline;
+        memset(&baseline, 0, sizeof(baseline));
+        perft_table_clear();
+        stats->single_thread_time = run_workers(&split, &baseline, 1);
+        perft_table_clear();
+    }
+
+    stats->wall_time = run_workers(&split, stats->workers, n_threads);
+
+    for (int i = 0; i < n_threads; i++)
+    {
+        stats->nodes += stats->workers[i].nodes;
+        stats->hash_probes += stats->workers[i].hash_probes;
+        stats->hash_hits += stats->workers[i].hash_hits;
+        stats->cpu_time += stats->workers[i].cpu_time;
+    }
+
+    pthread_mutex_destroy(&split.lock);
+}
+
+static void perft_position(ChessBoard *board, int depth, int n_threads, PerftStats *stats)
+{
+    ChessMove buffer[MAX_MOVES];
+    MoveList moves = move_list_from_buffer(buffer);
+    unsigned long long move_nodes[MAX_MOVES];
+
+    generate_all_legal_moves(board, &moves);
+    perft_split(board, &moves, depth, n_threads, move_nodes, stats);
+}
+
+static void print_speed(unsigned long long nodes, double seconds)
+{
+    printf("%llu nodes in %.3fs (%.0f nodes/s)\n", nodes, seconds, seconds > 0 ? nodes / seconds : 0.0);
+}
+
+static void print_hash_stats(unsigned long long probes, unsigned long long hits)
+{
+    if (perft_table != NULL)
+    {
+        printf("hash %llu entries, %llu probes, %.1f%% hit rate\n", (unsigned long long)perft_table_mask + 1,
+               probes, probes > 0 ? 100.0 * hits / probes : 0.0);
+    }
+}
+
+// speedup is the wall time of the split on one thread over the wall time on all of them. cpu utilization,
+// the cpu time of the workers over the wall time, shows how busy the threads were: contention or an
+// unbalanced split still count as busy, so it can be high with no speedup at all
+static void print_scaling(double single_thread_time, double wall_time, double cpu_time, int n_threads)
+{
+    printf("speedup %.2fx on %d threads (%.3fs on one thread), cpu utilization %.2f\n",
+           wall_time > 0 ? single_thread_time / wall_time : 0.0, n_threads, single_thread_time,
+           wall_time > 0 ? cpu_time / wall_time : 0.0);
+}
+
+static void print_stats(const PerftStats *stats)
+{
+    print_speed(stats->nodes, stats->wall_time);
+    print_hash_stats(stats->hash_probes, stats->hash_hits);
+
+    if (stats->n_threads > 1)
+    {
+        for (int i = 0; i < stats->n_threads; i++)
+        {
+            const PerftWorker *worker = &stats->workers[i];
+            printf("  thread %2d: %3d root moves, %12llu nodes, %.3fs cpu\n", i, worker->n_moves, worker->nodes,
+                   worker->cpu_time);
+        }
+        print_scaling(stats->single_thread_time, stats->wall_time, stats->cpu_time, stats->n_threads);
+    }
+}
+
+static bool divide(const char *fen, int depth, int n_threads)
+{
+    ChessBoard board;
+    FenError error = chess_board_from_fen(&board, fen);
+    if (error != FEN_OK)
+    {
+        printf("invalid fen: %s\n", fen_error_string(error));
+        return false;
+    }
+
+    ChessMove buffer[MAX_MOVES];
+    MoveList moves = move_list_from_buffer(buffer);
+    unsigned long long move_nodes[MAX_MOVES];
+    PerftStats stats;
+
+    generate_all_legal_moves(&board, &moves);
+    perft_split(&board, &moves, depth, n_threads, move_nodes, &stats);
+
+    for (int i = 0; i < moves.n_moves; i++)
+    {
+        char move_string[MOVE_STRING_LENGTH];
+        move_to_uci(moves.moves[i], move_string);
+        printf("%s: %llu\n", move_string, move_nodes[i]);
+    }
+
+    printf("\n%d moves, ", moves.n_moves);
+    print_stats(&stats);
+    return true;
+}
+
+static bool run(const char *fen, int depth, int n_threads)
+{
+    ChessBoard board;
+    FenError error = chess_board_from_fen(&board, fen);
+    if (error != FEN_OK)
+    {
+        printf("invalid fen: %s\n", fen_error_string(error));
+        return false;
+    }
+
+    PerftStats stats;
+    perft_position(&board, depth, n_threads, &stats);
+
+    print_stats(&stats);
+    return true;
+}
+
+// returns the number of failed positions
+static int run_suite(int max_depth, int n_threads)
+{
+    int failures = 0;
+    unsigned long long total_nodes = 0, total_probes = 0, total_hits = 0;
+    double total_time = 0, total_cpu_time = 0, total_single_thread_time = 0;
+
+    for (int i = 0; i < N_REFERENCE_POSITIONS; i++)
+    {
+        const ReferencePosition *position = &reference_positions[i];
+        int depth = max_depth > 0 ? max_depth : position->default_depth;
+        while (depth > 1 && position->nodes[depth - 1] == 0)
+        {
+            depth--;
+        }
+
+        ChessBoard board;
+        chess_board_from_fen(&board, position->fen);
+
+        PerftStats stats;
+        perft_position(&board, depth, n_threads, &stats);
+    
+        unsigned long long expected = position->nodes[depth - 1];
+        bool passed = stats.nodes == expected;
+        failures += !passed;
+        total_nodes += stats.nodes;
+        total_probes += stats.hash_probes;
+        total_hits += stats.hash_hits;
+        total_time += stats.wall_time;
+        total_cpu_time += stats.cpu_time;
+        total_single_thread_time += stats.single_thread_time;
+
+        printf("%-11s depth %d: %12llu nodes, expected %12llu  %s  %8.3fs %12.0f nodes/s\n", position->name,
+               depth, stats.nodes, expected, passed ? "ok  " : "FAIL", stats.wall_time,
+               stats.wall_time > 0 ? stats.nodes / stats.wall_time : 0.0);
+    }
+
+    printf("\n%d/%d positions passed, ", N_REFERENCE_POSITIONS - failures, N_REFERENCE_POSITIONS);
+    print_speed(total_nodes, total_time);
+    print_hash_stats(total_probes, total_hits);
+    if (n_threads > 1)
+    {
+        print_scaling(total_single_thread_time, total_time, total_cpu_time, n_threads);
+    }
+
+    return failures;
+}
+
+// perftsuite style lines, "<fen> ;D1 20 ;D2 400 ;...". depth 0 only parses the file and reports how fast.
+// returns the number of failed and invalid lines
+static int run_epd(const char *path, int max_depth, int n_threads)
+{
+    EpdReader reader;
+    if (!epd_reader_open(&reader, path))
+    {
+        return 1;
+    }
+
+    int n_positions = 0, failures = 0;
+    unsigned long long total_nodes = 0;
+    double total_time = 0;
+    EpdRecord record;
+    int status;
+    double start = wall_time();
+
+    while ((status = epd_reader_next(&reader, &record)) != 0)
+    {
+        if (status < 0)
+        {
+            printf("line %d: %s\n", record.line_number, fen_error_string(record.error));
+            failures++;
+            continue;
+        }
+
+        n_positions++;
+        for (int depth = 1; depth <= max_depth; depth++)
+        {
+            char opcode[16];
+            sprintf(opcode, "D%d", depth);
+            const char *operand = epd_find_operation(record.operations, opcode);
+            if (operand == NULL)
+            {
+                continue;
+            }
+
+            unsigned long long expected = strtoull(operand, NULL, 10);
+            PerftStats stats;
+            perft_position(&record.board, depth, n_threads, &stats);
+            total_nodes += stats.nodes;
+            total_time += stats.wall_time;
+
+            if (stats.nodes != expected)
+            {
+                printf("line %d depth %d: %llu nodes, expected %llu  FAIL\n", record.line_number, depth,
+                       stats.nodes, expected);
+                failures++;
+                break;
+            }
+        }
+    }
+
+    double read_time = wall_time() - start;
+    long n_bytes = ftell(reader.file);
+    epd_reader_close(&reader);
+
+    printf("%d positions, %d failures, ", n_positions, failures);
+    if (max_depth == 0)
+    {
+        printf("%ld bytes parsed in %.3fs (%.1f MB/s)\n", n_bytes, read_time,
+               read_time > 0 ? n_bytes / read_time / 1e6 : 0.0);
+        return failures;
+    }
+    print_speed(total_nodes, total_time);
+    return failures;
+}
+
+static int n_checks, n_failed_checks;
+
+static void check(bool passed, const char *what)
+{
+    n_checks++;
+    if (!passed)
+    {
+        printf("FAIL %s\n", what);
+        n_failed_checks++;
+    }
+}
+
+// a double push nobody can take en passant must not make the position differ from the same one reached later
+static void check_repetition(void)
+{
+    static const char *line[] = {"e4", "Nf6", "Nf3", "Ng8", "Ng1", "Nf6", "Nf3", "Ng8", "Ng1"};
+    const int n_moves = sizeof(line) / sizeof(line[0]);
+
+    ChessBoard board;
+    ChessHistory history;
+    chess_board_init(&board);
+    chess_history_init(&history, 0);
+
+    bool is_legal = true, is_early = false;
+    for (int i = 0; i < n_moves && is_legal; i++)
+    {
+        is_early |= chess_history_is_repetition(&history, &board);
+        ChessMove move = move_from_san(&board, line[i]);
+        is_legal = move != MOVE_NONE;
+        if (is_legal)
+        {
+            chess_history_make_move(&history, &board, move);
+        }
+    }
+
+    check(is_legal && !is_early && chess_history_is_repetition(&history, &board),
+          "threefold repetition after 1.e4 Nf6 2.Nf3 Ng8 3.Ng1 Nf6 4.Nf3 Ng8 5.Ng1");
+    chess_history_destroy(&history);
+}
+
+// undo and redo walk the recorded moves, and a new move after an undo drops the ones that could be redone.
+// the history starts with room for one record so that it has to grow
+static void check_history_redo(void)
+{
+    static const char *after_d5 = "rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2";
+    ChessBoard board, after_e5;
+    ChessHistory history;
+    char fen[FEN_MAX_LENGTH];
+    chess_board_init(&board);
+    chess_history_init(&history, 1);
+
+    bool matches = chess_history_make_move(&history, &board, move_from_san(&board, "e4")) &&
+                   chess_history_make_move(&history, &board, move_from_san(&board, "e5"));
+    after_e5 = board;
+
+    matches = matches && chess_history_undo(&history, &board) && chess_history_redo(&history, &board) &&
+              board.hash == after_e5.hash && !chess_history_redo(&history, &board);
+    matches = matches && chess_history_undo(&history, &board) &&
+              chess_history_make_move(&history, &board, move_from_san(&board, "d5")) &&
+              !chess_history_redo(&history, &board) && history.n_plies == 2 && history.n_records == 2;
+
+    chess_board_to_fen(&board, fen);
+    matches = matches && strcmp(fen, after_d5) == 0;
+    matches = matches && chess_history_undo(&history, &board) && chess_history_undo(&history, &board) &&
+              !chess_history_undo(&history, &board) && chess_history_redo(&history, &board) &&
+              chess_history_redo(&history, &board);
+    chess_board_to_fen(&board, fen);
+    matches = matches && strcmp(fen, after_d5) == 0;
+
+    check(matches, "1.e4 e5, undo, redo, undo, 1...d5 drops e5 from the moves to redo");
+    chess_history_destroy(&history);
+}
+
+// mate and stalemate queries answer for the color asked about, not for the side to move
+static void check_side_queries(void)
+{
+    ChessBoard board;
+    chess_board_from_fen(&board, "7k/5Q2/6K1/8/8/8/8/8 w - - 0 1");
+    check(chess_board_is_in_stalemate(&board, BLACK, true) && !chess_board_is_in_stalemate(&board, WHITE, true),
+          "stalemate of the side not to move");
+
+    chess_board_from_fen(&board, "8/8/8/8/8/6k1/5q2/7K w - - 0 1");
+    check(chess_board_does_side_have_legal_moves(&board, BLACK) &&
+              !chess_board_does_side_have_legal_moves(&board, WHITE),
+          "legal moves of the side not to move");
+}
+
+// positions that can't arise in a game are refused with the reason, not loaded
+static void check_fen_validation(void)
+{
+    static const struct
+    {
+        const char *fen;
+        FenError error;
+    } cases[] = {
+        {"7k/8/8/8/8/PPPPPPPP/PPPPPPPP/7K w - - 0 1", FEN_ERROR_MATERIAL},
+        {"NNNNNNNk/NNNNNNNN/NNNNNNNN/8/8/8/8/7K b - - 0 1", FEN_ERROR_MATERIAL},
+        {"7k/8/8/8/8/8/QQQQQQQQ/QQ5K w - - 0 1", FEN_ERROR_MATERIAL},
+        {"7k/8/8/8/8/8/PPPPPPP1/QQQ4K w - - 0 1", FEN_ERROR_MATERIAL},
+        {"7k/8/8/8/8/8/PPPPPP2/QQ5K w - - 0 1", FEN_OK},
+        {"P6k/8/8/8/8/8/8/7K w - - 0 1", FEN_ERROR_PAWN_RANK},
+        {"7k/8/8/8/8/8/8/p6K w - - 0 1", FEN_ERROR_PAWN_RANK},
+        {"8/8/8/8/8/8/8/7K w - - 0 1", FEN_ERROR_KINGS},
+        {"7k/8/8/8/8/8/8/8 w - - 0 1", FEN_ERROR_KINGS},
+        {"kk6/8/8/8/8/8/8/7K w - - 0 1", FEN_ERROR_KINGS},
+    };
+
+    for (int i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); i++)
+    {
+        ChessBoard board;
+        char what[128];
+        snprintf(what, sizeof(what), "fen %s: %s", cases[i].fen, fen_error_string(cases[i].error));
+        check(chess_board_from_fen(&board, cases[i].fen) == cases[i].error, what);
+    }
+}
+
+// the fen written for board reads back to a position with the same hash that is written the same way again
+static bool is_fen_round_trip(const ChessBoard *board, char *fen)
+{
+    ChessBoard read;
+    char again[FEN_MAX_LENGTH];
+
+    chess_board_to_fen(board, fen);
+    if (chess_board_from_fen(&read, fen) != FEN_OK)
+    {
+        return false;
+    }
+    chess_board_to_fen(&read, again);
+    return read.hash == board->hash && strcmp(fen, again) == 0;
+}
+
+// counts the positions below board, to depth plies, whose fen doesn't survive a round trip
+static int count_fen_mismatches(ChessBoard *board, int depth)
+{
+    ChessMove buffer[MAX_MOVES];
+    MoveList moves = move_list_from_buffer(buffer);
+    char fen[FEN_MAX_LENGTH];
+    int n_mismatches = 0;
+
+    generate_all_legal_moves(board, &moves);
+    for (int i = 0; i < moves.n_moves; i++)
+    {
+        MoveUndo undo;
+        chess_board_make_move(board, moves.moves[i], &undo);
+        n_mismatches += !is_fen_round_trip(board, fen);
+        if (depth > 1)
+        {
+            n_mismatches += count_fen_mismatches(board, depth - 1);
+        }
+        chess_board_undo_move(board, &undo);
+    }
+
+    return n_mismatches;
+}
+
+// counts the positions below board, to depth plies, whose incremental hash after make, copy-make or undo
+// differs from the hash computed from scratch
+static int count_hash_mismatches(ChessBoard *board, int depth)
+{
+    ChessMove buffer[MAX_MOVES];
+    MoveList moves = move_list_from_buffer(buffer);
+    uint64_t hash = board->hash;
+    int n_mismatches = 0;
+
+    generate_all_legal_moves(board, &moves);
+    for (int i = 0; i < moves.n_moves; i++)
+    {
+        ChessBoard copy;
+        chess_board_copy_make_move(&copy, board, moves.moves[i]);
+        n_mismatches += copy.hash != zobrist_hash(&copy);
+
+        MoveUndo undo;
+        chess_board_make_move(board, moves.moves[i], &undo);
+        n_mismatches += board->hash != zobrist_hash(board) || board->hash != copy.hash;
+        if (depth > 1)
+        {
+            n_mismatches += count_hash_mismatches(board, depth - 1);
+        }
+        chess_board_undo_move(board, &undo);
+        n_mismatches += board->hash != hash;
+    }
+
+    return n_mismatches;
+}
+
+// the hash make and undo keep up to date follows promotions, castling, en passant and lost rights
+static void check_hash(void)
+{
+    for (int i = 0; i < N_REFERENCE_POSITIONS; i++)
+    {
+        ChessBoard board;
+        char what[64];
+        chess_board_from_fen(&board, reference_positions[i].fen);
+        snprintf(what, sizeof(what), "incremental hash below %s", reference_positions[i].name);
+        check(board.hash == zobrist_hash(&board) && count_hash_mismatches(&board, 3) == 0, what);
+    }
+}
+
+// plays the space separated SAN moves, false as soon as one of them isn't legal
+static bool play_san_moves(ChessBoard *board, const char *moves)
+{
+    for (const char *c = moves; *c != '\0'; c += *c == ' ')
+    {
+        char san[MOVE_STRING_LENGTH];
+        size_t length = strcspn(c, " ");
+        if (length >= MOVE_STRING_LENGTH)
+        {
+            return false;
+        }
+        memcpy(san, c, length);
+        san[length] = '\0';
+        c += length;
+
+        ChessMove move = move_from_san(board, san);
+        if (move == MOVE_NONE)
+        {
+            return false;
+        }
+        MoveUndo undo;
+        chess_board_make_move(board, move, &undo);
+    }
+    return true;
+}
+
+// chess_board_to_fen writes back what from_fen read, and the en passant square, castling rights and move
+// counters that moves leave behind
+static void check_fen_round_trip(void)
+{
+    static const struct
+    {
+        const char *fen;
+        const char *moves;
+        const char *expected;
+    } cases[] = {
+        {START_FEN, "e4", "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1"},
+        {START_FEN, "e4 d5 e5 f5", "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3"},
+        {START_FEN, "Nf3 Nf6 Ng1 Ng8 Nc3", "rnbqkbnr/pppppppp/8/8/8/2N5/PPPPPPPP/R1BQKBNR b KQkq - 5 3"},
+        {START_FEN, "e4 d5 exd5", "rnbqkbnr/ppp1pppp/8/3P4/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2"},
+        {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", "Rb1 Kf8",
+         "r4k1r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/1R2K2R w K - 2 2"},
+        {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", "Nxf7 Rb8 Nxh8",
+         "1r2k2N/p1ppq1b1/bn2pnp1/3P4/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQ - 0 2"},
+    };
+
+    for (int i = 0; i < N_REFERENCE_POSITIONS; i++)
+    {
+        ChessBoard board;
+        char fen[FEN_MAX_LENGTH], what[64];
+        chess_board_from_fen(&board, reference_positions[i].fen);
+        snprintf(what, sizeof(what), "fen round trip below %s", reference_positions[i].name);
+        check(is_fen_round_trip(&board, fen) && strcmp(fen, reference_positions[i].fen) == 0 &&
+                  count_fen_mismatches(&board, 3) == 0,
+              what);
+    }
+
+    for (int i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); i++)
+    {
+        ChessBoard board;
+        char fen[FEN_MAX_LENGTH], what[160];
+        chess_board_from_fen(&board, cases[i].fen);
+        snprintf(what, sizeof(what), "fen %s after %s", cases[i].expected, cases[i].moves);
+        check(play_san_moves(&board, cases[i].moves) && is_fen_round_trip(&board, fen) &&
+                  strcmp(fen, cases[i].expected) == 0,
+              what);
+    }
+}
+
+// the reader strips CRLF endings, skips blank lines, takes a last line without a newline and goes on
+// reading after an invalid line
+static void check_epd_reader(void)
+{
+    static const char *path = "perft_check.epd";
+    static const char *contents = START_FEN " ;D1 20\r\n"
+                                  "\r\n"
+                                  "\n"
+                                  " \t\n"
+                                  "not a position ;D1 1\n"
+                                  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - ;D2 191 ;D1 14\r\n"
+                                  "7k/8/8/8/8/8/8/7K w - - 0 1";
+    static const struct
+    {
+        int status;
+        int line_number;
+        const char *fen;
+        const char *d1;
+    } expected[] = {
+        {1, 1, START_FEN, "20"},
+        {-1, 5, NULL, NULL},
+        {1, 6, "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", "14"},
+        {1, 7, "7k/8/8/8/8/8/8/7K w - - 0 1", NULL},
+        {0, 7, NULL, NULL},
+    };
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        check(false, "EPD reader test file can be written");
+        return;
+    }
+    fputs(contents, file);
+    fclose(file);
+
+    EpdReader reader;
+    bool matches = epd_reader_open(&reader, path);
+    for (int i = 0; i < (int)(sizeof(expected) / sizeof(expected[0])) && matches; i++)
+    {
+        EpdRecord record;
+        char fen[FEN_MAX_LENGTH];
+        int status = epd_reader_next(&reader, &record);
+
+        matches = status == expected[i].status;
+        if (matches && status != 0)
+        {
+            matches = record.line_number == expected[i].line_number;
+        }
+        if (matches && status > 0)
+        {
+            const char *d1 = epd_find_operation(record.operations, "D1");
+            chess_board_to_fen(&record.board, fen);
+            matches = strcmp(fen, expected[i].fen) == 0 &&
+                      (expected[i].d1 == NULL ? d1 == NULL : d1 != NULL && strcmp(d1, expected[i].d1) == 0);
+        }
+        if (matches && status < 0)
+        {
+            matches = record.error != FEN_OK;
+        }
+    }
+    if (reader.file != NULL)
+    {
+        epd_reader_close(&reader);
+    }
+    remove(path);
+
+    check(matches, "EPD reader line endings, blank lines, invalid lines and a last line without a newline");
+}
+
+// counts the legal moves below board, to depth plies, whose SAN or UCI text doesn't decode back to the move
+static int count_notation_mismatches(ChessBoard *board, int depth)
+{
+    ChessMove buffer[MAX_MOVES];
+    MoveList moves = move_list_from_buffer(buffer);
+    int n_mismatches = 0;
+
+    generate_all_legal_moves(board, &moves);
+    for (int i = 0; i < moves.n_moves; i++)
+    {
+        char san[MOVE_STRING_LENGTH], uci[MOVE_STRING_LENGTH];
+        move_to_san(board, moves.moves[i], san);
+        move_to_uci(moves.moves[i], uci);
+        n_mismatches += move_from_san(board, san) != moves.moves[i];
+        n_mismatches += move_from_uci(board, uci) != moves.moves[i];
+
+        if (depth > 1)
+        {
+            MoveUndo undo;
+            chess_board_make_move(board, moves.moves[i], &undo);
+            n_mismatches += count_notation_mismatches(board, depth - 1);
+            chess_board_undo_move(board, &undo);
+        }
+    }
+
+    return n_mismatches;
+}
+
+// the move given in UCI is written as san, and san (or a variation of it) decodes back to it
+static void check_san(const char *fen, const char *uci, const char *san, const char *variation)
+{
+    ChessBoard board;
+    char written[MOVE_STRING_LENGTH] = "";
+    char what[160];
+
+    chess_board_from_fen(&board, fen);
+    ChessMove move = move_from_uci(&board, uci);
+    if (move != MOVE_NONE)
+    {
+        move_to_san(&board, move, written);
+    }
+
+    snprintf(what, sizeof(what), "%s in %s written as %s, read from %s", uci, fen, san, variation);
+    check(move != MOVE_NONE && strcmp(written, san) == 0 && move_from_san(&board, san) == move &&
+              move_from_san(&board, variation) == move,
+          what);
+}
+
+static void check_notation(void)
+{
+    for (int i = 0; i < N_REFERENCE_POSITIONS; i++)
+    {
+        ChessBoard board;
+        char what[64];
+        chess_board_from_fen(&board, reference_positions[i].fen);
+        snprintf(what, sizeof(what), "SAN and UCI round trip below %s", reference_positions[i].name);
+        check(count_notation_mismatches(&board, 3) == 0, what);
+    }
+
+    static const char *knights = "rnbqkb1r/ppp1pppp/5n2/3p4/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1";
+    static const char *rooks = "7k/8/8/8/8/4R3/8/4R1K1 w - - 0 1";
+    static const char *kiwipete = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    static const char *en_passant = "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3";
+    static const char *promotion = "8/P6k/8/8/8/8/8/K7 w - - 0 1";
+
+    check_san(knights, "b8d7", "Nbd7", "Nb8d7");
+    check_san(knights, "f6d7", "Nfd7", "Nf6d7");
+    check_san(rooks, "e1e2", "R1e2", "Re1e2");
+    check_san(kiwipete, "e1g1", "O-O", "0-0");
+    check_san(kiwipete, "e1c1", "O-O-O", "0-0-0");
+    check_san(en_passant, "e5f6", "exf6", "exf6 e.p.");
+    check_san(promotion, "a7a8q", "a8=Q", "a8Q");
+    check_san(promotion, "a7a8n", "a8=N", "a8=N!?");
+    check_san("4k3/8/8/8/8/8/8/R3K3 w - - 0 1", "a1a8", "Ra8+", "Ra8");
+    check_san("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", "a1a8", "Ra8#", "Ra8+");
+
+    ChessBoard board;
+    chess_board_from_fen(&board, knights);
+    check(move_from_san(&board, "Nd7") == MOVE_NONE, "ambiguous Nd7 is refused");
+    check(move_from_san(&board, "Nc6") != MOVE_NONE && move_from_san(&board, "Ne5") == MOVE_NONE &&
+              move_from_uci(&board, "b8d6") == MOVE_NONE && move_from_san(&board, "Qd9") == MOVE_NONE,
+          "unplayable or malformed moves are refused");
+}
+
+// the signature counts match the boards, up to the most pieces of a kind promotions allow
+static void check_material(void)
+{
+    static const struct
+    {
+        const char *fen;
+        bool is_draw;
+    } cases[] = {
+        {"7k/8/8/8/8/8/8/7K w - - 0 1", true},
+        {"7k/8/8/8/8/8/8/5B1K w - - 0 1", true},
+        {"7k/8/8/8/8/8/8/5N1K b - - 0 1", true},
+        {"2b4k/8/8/8/8/8/8/5B1K w - - 0 1", true},
+        {"1b4k1/8/8/8/8/8/8/B6K w - - 0 1", true},
+        {"1b5k/8/8/8/8/8/8/5B1K w - - 0 1", false},
+        {"7k/8/8/8/8/8/8/4NN1K w - - 0 1", false},
+        {"7k/8/8/8/8/8/6P1/7K w - - 0 1", false},
+        {"7k/8/8/8/8/8/8/6RK w - - 0 1", false},
+        {"NNNNNNNN/8/8/8/8/8/1k6/NN5K w - - 0 1", false},
+        {"4k3/8/8/8/8/8/BBBBBBBB/BB4K1 w - - 0 1", false},
+        {"QQQQQQQQ/8/8/8/8/8/8/Q3K2k b - - 0 1", false},
+    };
+
+    for (int i = 0; i < (int)(sizeof(cases) / sizeof(cases[0])); i++)
+    {
+        ChessBoard board;
+        char what[128];
+        bool is_valid = chess_board_from_fen(&board, cases[i].fen) == FEN_OK;
+        bool counts_match = is_valid;
+
+        for (ChessColor color = BLACK; color <= WHITE && is_valid; color++)
+        {
+            Bitboard bishops = chess_board_pieces(&board, PIECE_BISHOP, color);
+            int light_bishops = bb_popcount(bishops & 0x55AA55AA55AA55AAULL);
+
+            int expected[N_MATERIAL_KINDS] = {
+                bb_popcount(chess_board_pieces(&board, PIECE_PAWN, color)),
+                bb_popcount(chess_board_pieces(&board, PIECE_KNIGHT, color)),
+                light_bishops,
+                bb_popcount(bishops) - light_bishops,
+                bb_popcount(chess_board_pieces(&board, PIECE_ROOK, color)),
+                bb_popcount(chess_board_pieces(&board, PIECE_QUEEN, color)),
+            };
+            for (MaterialKind kind = 0; kind < N_MATERIAL_KINDS; kind++)
+            {
+                counts_match &= chess_board_material_count(&board, kind, color) == expected[kind];
+            }
+        }
+
+        snprintf(what, sizeof(what), "material of %s%s", cases[i].fen, cases[i].is_draw ? " is a draw" : "");
+        check(counts_match && chess_board_is_insufficient_material(&board) == cases[i].is_draw, what);
+    }
+}
+
+// the picker hands out every legal move once, in stage order: the hash move, the captures that don't lose
+// material by value, push promotions, the quiet killer, the quiet moves and last the losing captures
+static void check_move_picker(void)
+{
+    // exd5 and Qxd5 win the queen, Bxc6 trades evenly, Qxh5 loses the queen for a pawn
+    static const char *fen = "7k/Pp6/2n3p1/1B1q3p/4P3/8/7P/3Q2K1 w - - 0 1";
+    static const char *expected_start[] = {"h2h3", "e4d5", "d1d5", "b5c6", "a7a8n", "a7a8b", "a7a8r", "a7a8q",
+                                           "h2h4"};
+    const int n_expected_start = sizeof(expected_start) / sizeof(expected_start[0]);
+
+    ChessBoard board;
+    chess_board_from_fen(&board, fen);
+    ChessMove killers[2] = {move_from_uci(&board, "h2h4"), move_from_uci(&board, "e4d5")};
+    MovePicker picker;
+    move_picker_init(&picker, &board, move_from_uci(&board, "h2h3"), killers);
+
+    ChessMove picked[MAX_MOVES];
+    int n_picked = 0;
+    ChessMove move;
+    while ((move = move_picker_next(&picker)) != MOVE_NONE && n_picked < MAX_MOVES)
+    {
+        picked[n_picked++] = move;
+    }
+
+    ChessMove buffer[MAX_MOVES];
+    MoveList moves = move_list_from_buffer(buffer);
+    generate_all_legal_moves(&board, &moves);
+
+    bool in_order = n_picked == moves.n_moves && n_picked > n_expected_start;
+    for (int i = 0; i < n_expected_start && in_order; i++)
+    {
+        in_order = picked[i] == move_from_uci(&board, expected_start[i]);
+    }
+    for (int i = n_expected_start; i < n_picked - 1 && in_order; i++)
+    {
+        in_order = !move_is_capture(picked[i]) && !move_is_promotion(picked[i]);
+    }
+    in_order = in_order && picked[n_picked - 1] == move_from_uci(&board, "d1h5");
+
+    // with as many moves as legal ones, no repeats means every legal move was picked
+    for (int i = 0; i < n_picked && in_order; i++)
+    {
+        for (int j = i + 1; j < n_picked && in_order; j++)
+        {
+            in_order = picked[i] != picked[j];
+        }
+    }
+
+    check(in_order, "move picker stage order");
+}
+
+// returns the number of failed checks
+static int run_checks(void)
+{
+    check_repetition();
+    check_history_redo();
+    check_side_queries();
+    check_fen_validation();
+    check_fen_round_trip();
+    check_epd_reader();
+    check_hash();
+    check_notation();
+    check_material();
+    check_move_picker();
+
+    printf("%d checks, %d failed\n", n_checks, n_failed_checks);
+    return n_failed_checks;
+}
+
+int main(int argc, char **argv)
+{
+    int n_threads = 1;
+    int hash_mb = 0;
+    unsigned features = cpu_features();
+    while (argc > 2 && argv[1][0] == '-')
+    {
+        int value = atoi(argv[2]);
+        if (strcmp(argv[1], "-t") == 0)
+        {
+            n_threads = value < 1 ? 1 : value > MAX_THREADS ? MAX_THREADS : value;
+        }
+        else if (strcmp(argv[1], "-h") == 0)
+        {
+            hash_mb = value < 0 ? 0 : value > MAX_HASH_MB ? MAX_HASH_MB : value;
+        }
+        else if (strcmp(argv[1], "-c") == 0)
+        {
+            use_copy_make = value != 0;
+        }
+        else if (strcmp(argv[1], "-p") == 0)
+        {
+            use_move_picker = value != 0;
+        }
+        else if (strcmp(argv[1], "-f") == 0)
+        {
+            features &= value;
+        }
+        else
+        {
+            break;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+
+    attacks_init_with_features(features);
+    zobrist_init();
+    printf("attack kernels: %s\n", attacks_backend_name());
+
+    if (hash_mb > 0 && !perft_table_init(hash_mb))
+    {
+        printf("could not allocate a %d MB hash table\n", hash_mb);
+        return 1;
+    }
+
+    if (argc <= 1)
+    {
+        return run_suite(0, n_threads) == 0 ? 0 : 1;
+    }
+
+    const char *mode = argv[1];
+    int depth = argc > 2 ? atoi(argv[2]) : 0;
+    depth = depth < MAX_PERFT_DEPTH ? depth : 0;
+    const char *fen = argc > 3 ? argv[3] : START_FEN;
+
+    if (strcmp(mode, "check") == 0)
+    {
+        return run_checks() == 0 ? 0 : 1;
+    }
+    if (strcmp(mode, "suite") == 0 && depth > 0)
+    {
+        return run_suite(depth, n_threads) == 0 ? 0 : 1;
+    }
+    if (strcmp(mode, "run") == 0 && depth > 0)
+    {
+        return run(fen, depth, n_threads) ? 0 : 1;
+    }
+    if (strcmp(mode, "divide") == 0 && depth > 0)
+    {
+        return divide(fen, depth, n_threads) ? 0 : 1;
+    }
+    if (strcmp(mode, "epd") == 0 && depth >= 0 && argc > 3)
+    {
+        return run_epd(argv[3], depth, n_threads) == 0 ? 0 : 1;
+    }
+
+    printf("usage: %s [-t threads] [-h mb] [-c 1] [-p 1] [-f features]\n", argv[0]);
+    printf("       [suite <depth> | run <depth> [fen] | divide <depth> [fen] | epd <depth> <file> | check]\n");
+    return 1;
+}
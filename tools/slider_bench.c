@@ -0,0 +1,238 @@
+// Compares the magic bitboard slider lookups against walking rays over the board mailbox, the way the
+// move generators used to, on the sliders of a fixed set of positions. Then checks and times the set-wise
+// attacks of all the sliders of a side, with every kernel this cpu can run.
+
+#include <stdio.h>
+#include <time.h>
+
+#include "chess/attacks.h"
+#include "chess/board.h"
+#include "chess/cpu.h"
+
+#define ITERATIONS 200000
+#define MAX_QUERIES 256
+
+typedef struct
+{
+    const ChessBoard *board;
+    Bitboard occupancy;
+    int square;
+    PieceType type;
+} SliderQuery;
+
+// all the sliders of one side, with their attacks found by the ray walker
+typedef struct
+{
+    Bitboard diagonal;
+    Bitboard orthogonal;
+    Bitboard occupancy;
+    Bitboard reference;
+} SetQuery;
+
+static const char *positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "2r3k1/1q1nbppp/r3p3/3pP3/pPpP4/P1Q2N2/2RN1PPP/2R4K b - - 0 1",
+    "8/8/1B6/8/3q4/8/5R2/k1K5 w - - 0 1",
+};
+
+#define N_POSITIONS (int)(sizeof(positions) / sizeof(positions[0]))
+
+static const int diagonal_directions[4][2] = {{1, 1}, {1, -1}, {-1, -1}, {-1, 1}};
+static const int straight_directions[4][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}};
+
+static Bitboard ray_walk(const ChessBoard *board, int square, const int directions[4][2])
+{
+    Bitboard attacks = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        int x = SQUARE_FILE(square) + directions[i][0];
+        int y = SQUARE_RANK(square) + directions[i][1];
+
+        while (x >= 0 && x < 8 && y >= 0 && y < 8)
+        {
+            attacks |= SQUARE_BB(SQUARE_INDEX(x, y));
+
+            if (board->mailbox[SQUARE_INDEX(x, y)] != PIECE_CODE_NONE)
+            {
+                break;
+            }
+
+            x += directions[i][0];
+            y += directions[i][1];
+        }
+    }
+
+    return attacks;
+}
+
+static Bitboard ray_walker_attacks(const SliderQuery *q)
+{
+    switch (q->type)
+    {
+    case PIECE_BISHOP:
+        return ray_walk(q->board, q->square, diagonal_directions);
+    case PIECE_ROOK:
+        return ray_walk(q->board, q->square, straight_directions);
+    default:
+        return ray_walk(q->board, q->square, diagonal_directions) |
+               ray_walk(q->board, q->square, straight_directions);
+    }
+}
+
+static Bitboard magic_attacks(const SliderQuery *q)
+{
+    switch (q->type)
+    {
+    case PIECE_BISHOP:
+        return attacks_bishop(q->square, q->occupancy);
+    case PIECE_ROOK:
+        return attacks_rook(q->square, q->occupancy);
+    default:
+        return attacks_queen(q->square, q->occupancy);
+    }
+}
+
+static double run(Bitboard (*attacks)(const SliderQuery *), const SliderQuery *queries, int n_queries,
+                  Bitboard *checksum)
+{
+    clock_t start = clock();
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        for (int j = 0; j < n_queries; j++)
+        {
+            *checksum += attacks(&queries[j]);
+        }
+    }
+
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static SetQuery set_query(const ChessBoard *board, ChessColor color)
+{
+    Bitboard queens = chess_board_pieces(board, PIECE_QUEEN, color);
+    SetQuery q = {chess_board_pieces(board, PIECE_BISHOP, color) | queens,
+                  chess_board_pieces(board, PIECE_ROOK, color) | queens, chess_board_occupancy(board), 0};
+
+    for (Bitboard pieces = q.diagonal; pieces;)
+    {
+        q.reference |= ray_walk(board, bb_pop_lsb(&pieces), diagonal_directions);
+    }
+    for (Bitboard pieces = q.orthogonal; pieces;)
+    {
+        q.reference |= ray_walk(board, bb_pop_lsb(&pieces), straight_directions);
+    }
+    return q;
+}
+
+// checks attacks_sliders against the ray walker, then times it. returns a negative time on a mismatch
+static double run_set(const SetQuery *queries, int n_queries, Bitboard *checksum)
+{
+    for (int i = 0; i < n_queries; i++)
+    {
+        if (attacks_sliders(queries[i].diagonal, queries[i].orthogonal, queries[i].occupancy) !=
+            queries[i].reference)
+        {
+            printf("Set-wise mismatch for side %d of position %d\n", i % 2, i / 2);
+            return -1;
+        }
+    }
+
+    clock_t start = clock();
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        for (int j = 0; j < n_queries; j++)
+        {
+            *checksum += attacks_sliders(queries[j].diagonal, queries[j].orthogonal, queries[j].occupancy);
+        }
+    }
+
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main()
+{
+    unsigned features = cpu_features();
+    attacks_init_with_features(features);
+
+    static ChessBoard boards[N_POSITIONS];
+    SliderQuery queries[MAX_QUERIES];
+    int n_queries = 0;
+
+    for (int i = 0; i < N_POSITIONS; i++)
+    {
+        chess_board_from_fen(&boards[i], positions[i]);
+
+        PieceType sliders[] = {PIECE_BISHOP, PIECE_ROOK, PIECE_QUEEN};
+        for (int j = 0; j < 3; j++)
+        {
+            Bitboard pieces = boards[i].pieces[sliders[j]];
+            while (pieces)
+            {
+                queries[n_queries++] = (SliderQuery){&boards[i], chess_board_occupancy(&boards[i]),
+                                                     bb_pop_lsb(&pieces), sliders[j]};
+            }
+        }
+    }
+
+    for (int i = 0; i < n_queries; i++)
+    {
+        if (ray_walker_attacks(&queries[i]) != magic_attacks(&queries[i]))
+        {
+            printf("Mismatch for slider on square %d of position %d\n", queries[i].square,
+                   (int)(queries[i].board - boards));
+            return 1;
+        }
+    }
+
+    Bitboard checksum = 0;
+    double ray_time = run(ray_walker_attacks, queries, n_queries, &checksum);
+    double magic_time = run(magic_attacks, queries, n_queries, &checksum);
+
+    double lookups = (double)ITERATIONS * n_queries;
+    printf("%d positions, %d sliders, %.0f lookups each (checksum %016llx)\n", N_POSITIONS, n_queries, lookups,
+           (unsigned long long)checksum);
+    printf("ray walker: %8.3fs  %6.2f ns/lookup\n", ray_time, ray_time * 1e9 / lookups);
+    printf("tables:     %8.3fs  %6.2f ns/lookup (%s)\n", magic_time, magic_time * 1e9 / lookups,
+           slider_indexing == SLIDER_INDEX_PEXT ? "pext" : "magic");
+    printf("speedup:    %8.2fx\n", ray_time / magic_time);
+
+    // every side of every position at once, with the AVX2 fill if there is one and the lookup fallback
+    SetQuery set_queries[2 * N_POSITIONS];
+    for (int i = 0; i < N_POSITIONS; i++)
+    {
+        set_queries[2 * i] = set_query(&boards[i], BLACK);
+        set_queries[2 * i + 1] = set_query(&boards[i], WHITE);
+    }
+
+    double fills = (double)ITERATIONS * 2 * N_POSITIONS;
+    printf("\nset-wise:   %d sides, %.0f fills each\n", 2 * N_POSITIONS, fills);
+
+    if (features & CPU_AVX2)
+    {
+        double avx2_time = run_set(set_queries, 2 * N_POSITIONS, &checksum);
+        if (avx2_time < 0)
+        {
+            return 1;
+        }
+        printf("avx2 fill:  %8.3fs  %6.2f ns/side\n", avx2_time, avx2_time * 1e9 / fills);
+        attacks_init_with_features(features & ~CPU_AVX2);
+    }
+
+    double lookup_time = run_set(set_queries, 2 * N_POSITIONS, &checksum);
+    if (lookup_time < 0)
+    {
+        return 1;
+    }
+    printf("lookups:    %8.3fs  %6.2f ns/side (checksum %016llx)\n", lookup_time, lookup_time * 1e9 / fills,
+           (unsigned long long)checksum);
+
+    return 0;
+}